@@ -0,0 +1,342 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_BENCHMARK_ALLOCATIONS_H
+#define BENCODE_BENCHMARK_ALLOCATIONS_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <benchmark/benchmark.h>
+
+// Counts heap allocations by replacing the global operator new/delete and, on
+// glibc, by interposing malloc/calloc/realloc/free and the aligned allocators
+// so allocations made through the C allocator are seen as well. Every
+// benchmark is a single translation unit, so this header is included once per
+// executable. Define BENCODE_BENCHMARK_NO_ALLOCATIONS to build without the
+// hook.
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define BENCODE_BENCHMARK_SANITIZER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BENCODE_BENCHMARK_SANITIZER
+#endif
+#endif
+
+#if defined(__GLIBC__) && !defined(BENCODE_BENCHMARK_SANITIZER)
+#define BENCODE_BENCHMARK_INTERPOSE_MALLOC
+#endif
+
+namespace allocations {
+
+namespace internal {
+
+inline std::atomic<std::size_t> count{0};
+inline std::atomic<std::size_t> bytes{0};
+inline std::atomic<std::size_t> live{0};
+inline std::atomic<std::size_t> peak{0};
+
+/**
+ * @brief size of the block behind p as the allocator sees it, zero when the
+ * platform has no way to ask, live and peak bytes are not tracked then
+ */
+inline std::size_t UsableSize([[maybe_unused]] void *p) {
+#if defined(__GLIBC__)
+  return malloc_usable_size(p);
+#elif defined(__APPLE__)
+  return malloc_size(p);
+#else
+  return 0;
+#endif
+}
+
+inline void Allocated(void *p, const std::size_t size) {
+  if (p == nullptr) {
+    return;
+  }
+  count.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+
+  const std::size_t usable = UsableSize(p);
+  const std::size_t now =
+      live.fetch_add(usable, std::memory_order_relaxed) + usable;
+  std::size_t prev = peak.load(std::memory_order_relaxed);
+  while (now > prev &&
+         !peak.compare_exchange_weak(prev, now, std::memory_order_relaxed)) {
+  }
+}
+
+inline void Freed(void *p) {
+  if (p != nullptr) {
+    live.fetch_sub(UsableSize(p), std::memory_order_relaxed);
+  }
+}
+
+} // namespace internal
+
+/**
+ * @brief reports the allocations made while it is alive as per-iteration
+ * "allocs" and "alloc_bytes" counters, plus "peak_bytes", the highest number
+ * of live heap bytes above what was live when the scope started
+ */
+class Scope {
+#if !defined(BENCODE_BENCHMARK_NO_ALLOCATIONS)
+  benchmark::State &state_;
+  std::size_t count_;
+  std::size_t bytes_;
+  std::size_t live_;
+
+public:
+  explicit Scope(benchmark::State &state)
+      : state_(state),
+        count_(internal::count.load(std::memory_order_relaxed)),
+        bytes_(internal::bytes.load(std::memory_order_relaxed)),
+        live_(internal::live.load(std::memory_order_relaxed)) {
+    internal::peak.store(live_, std::memory_order_relaxed);
+  }
+
+  ~Scope() {
+    const auto per_iteration = [](const std::size_t value) {
+      return benchmark::Counter(static_cast<double>(value),
+                                benchmark::Counter::kAvgIterations,
+                                benchmark::Counter::kIs1024);
+    };
+    state_.counters["allocs"] = per_iteration(
+        internal::count.load(std::memory_order_relaxed) - count_);
+    state_.counters["alloc_bytes"] = per_iteration(
+        internal::bytes.load(std::memory_order_relaxed) - bytes_);
+    state_.counters["peak_bytes"] = benchmark::Counter(
+        static_cast<double>(internal::peak.load(std::memory_order_relaxed) -
+                            live_),
+        benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+  }
+#else
+public:
+  explicit Scope(benchmark::State &) {}
+#endif
+};
+
+} // namespace allocations
+
+#if !defined(BENCODE_BENCHMARK_NO_ALLOCATIONS)
+
+// kept out of line, once inlined gcc pairs the malloc/free inside with the
+// new/delete at the call site and reports a mismatch
+#if defined(__GNUC__)
+#define BENCODE_BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define BENCODE_BENCHMARK_NOINLINE
+#endif
+
+#if defined(BENCODE_BENCHMARK_INTERPOSE_MALLOC)
+
+extern "C" {
+
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t n, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+void *__libc_memalign(std::size_t alignment, std::size_t size);
+void *__libc_valloc(std::size_t size);
+void *__libc_pvalloc(std::size_t size);
+void __libc_free(void *p);
+
+void *malloc(std::size_t size) noexcept {
+  void *p = __libc_malloc(size);
+  allocations::internal::Allocated(p, size);
+  return p;
+}
+
+void *calloc(std::size_t n, std::size_t size) noexcept {
+  void *p = __libc_calloc(n, size);
+  allocations::internal::Allocated(p, n * size);
+  return p;
+}
+
+void *realloc(void *p, std::size_t size) noexcept {
+  allocations::internal::Freed(p);
+  void *q = __libc_realloc(p, size);
+  if (q == nullptr && size != 0) {
+    // the old block is still alive
+    allocations::internal::live.fetch_add(
+        allocations::internal::UsableSize(p), std::memory_order_relaxed);
+    return q;
+  }
+  allocations::internal::Allocated(q, size);
+  return q;
+}
+
+// free() subtracts every block it is handed, so blocks from the aligned
+// allocators have to be added as well or the live bytes underflow
+void *memalign(std::size_t alignment, std::size_t size) noexcept {
+  void *p = __libc_memalign(alignment, size);
+  allocations::internal::Allocated(p, size);
+  return p;
+}
+
+void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, std::size_t alignment,
+                   std::size_t size) noexcept {
+  if (alignment % sizeof(void *) != 0 ||
+      (alignment & (alignment - 1)) != 0 || alignment == 0) {
+    return EINVAL;
+  }
+  void *p = memalign(alignment, size);
+  if (p == nullptr) {
+    return ENOMEM;
+  }
+  *out = p;
+  return 0;
+}
+
+void *valloc(std::size_t size) noexcept {
+  void *p = __libc_valloc(size);
+  allocations::internal::Allocated(p, size);
+  return p;
+}
+
+void *pvalloc(std::size_t size) noexcept {
+  void *p = __libc_pvalloc(size);
+  allocations::internal::Allocated(p, size);
+  return p;
+}
+
+void free(void *p) noexcept {
+  allocations::internal::Freed(p);
+  __libc_free(p);
+}
+
+} // extern "C"
+
+// malloc already does the counting
+BENCODE_BENCHMARK_NOINLINE void *operator new(std::size_t size) {
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+BENCODE_BENCHMARK_NOINLINE void *operator new(std::size_t size,
+                                              std::align_val_t alignment) {
+  if (void *p = memalign(static_cast<std::size_t>(alignment),
+                         size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete(void *p,
+                                                std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#else
+
+BENCODE_BENCHMARK_NOINLINE void *operator new(std::size_t size) {
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    allocations::internal::Allocated(p, size);
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete(void *p) noexcept {
+  allocations::internal::Freed(p);
+  std::free(p);
+}
+
+BENCODE_BENCHMARK_NOINLINE void *operator new(std::size_t size,
+                                              std::align_val_t alignment) {
+  const auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc wants a multiple of the alignment
+  const std::size_t padded = (size + align - 1) / align * align;
+  if (void *p = std::aligned_alloc(align, padded == 0 ? align : padded)) {
+    allocations::internal::Allocated(p, size);
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete(void *p,
+                                                std::align_val_t) noexcept {
+  allocations::internal::Freed(p);
+  std::free(p);
+}
+
+#endif // BENCODE_BENCHMARK_INTERPOSE_MALLOC
+
+BENCODE_BENCHMARK_NOINLINE void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete[](void *p) noexcept {
+  operator delete(p);
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete(void *p, std::size_t) noexcept {
+  operator delete(p);
+}
+
+BENCODE_BENCHMARK_NOINLINE void operator delete[](void *p,
+                                                  std::size_t) noexcept {
+  operator delete(p);
+}
+
+BENCODE_BENCHMARK_NOINLINE void *operator new[](std::size_t size,
+                                                std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+BENCODE_BENCHMARK_NOINLINE void
+operator delete[](void *p, std::align_val_t alignment) noexcept {
+  operator delete(p, alignment);
+}
+
+BENCODE_BENCHMARK_NOINLINE void
+operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept {
+  operator delete(p, alignment);
+}
+
+BENCODE_BENCHMARK_NOINLINE void
+operator delete[](void *p, std::size_t, std::align_val_t alignment) noexcept {
+  operator delete(p, alignment);
+}
+
+#endif // !BENCODE_BENCHMARK_NO_ALLOCATIONS
+
+#endif // BENCODE_BENCHMARK_ALLOCATIONS_H
@@ -24,33 +24,554 @@
 // Created by Homing So on 24-5-24.
 //
 
+#include <cstdint>
+#include <cstdio>
+
 #include <filesystem>
 #include <fstream>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
+#include "bencode/binding.h"
+#include "bencode/canonical.h"
 #include "bencode/document.h"
+#include "bencode/file_read_stream.h"
+#include "bencode/file_write_stream.h"
+#include "bencode/istream_wrapper.h"
+#include "bencode/key_table.h"
+#include "bencode/metainfo.h"
+#include "bencode/ostream_wrapper.h"
+#include "bencode/reader.h"
+#include "bencode/string_read_stream.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
 
+#include "allocations.h"
+#include "perf_counters.h"
 #include "resources.h"
 
+namespace {
+
+std::string ReadFile(const std::filesystem::path &path) {
+  auto ifs = std::ifstream(path, std::ifstream::binary);
+  return {std::istreambuf_iterator<char>{ifs},
+          std::istreambuf_iterator<char>{}};
+}
+
+template <class Stream>
+void DecodeIStream(benchmark::State &state, Stream &stream,
+                   const std::size_t size) {
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      stream.clear();
+      stream.seekg(0);
+      bencode::IStreamWrapper is(stream);
+      benchmark::DoNotOptimize(bencode::Document().ParseStream(is));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+bencode::Document Load(const std::filesystem::path &path) {
+  bencode::Document doc;
+  doc.Parse(ReadFile(path));
+  return doc;
+}
+
+std::size_t EncodedSize(const bencode::Value &value) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  value.WriteTo(writer);
+  return os.get().size();
+}
+
+void EncodeToFile(benchmark::State &state, const std::filesystem::path &path,
+                  std::FILE *fp) {
+  if (fp == nullptr) {
+    state.SkipWithError("can not open the output file");
+    return;
+  }
+  const auto doc = Load(path);
+  char buffer[65536];
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      std::rewind(fp);
+      bencode::FileWriteStream os(fp, buffer);
+      bencode::BatchWriter writer(os);
+      doc.WriteTo(writer);
+      os.flush();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * EncodedSize(doc));
+  std::fclose(fp);
+}
+
+struct TorrentFile {
+  int64_t length_{};
+  std::vector<std::string> path_;
+};
+
+struct TorrentInfo {
+  std::vector<TorrentFile> files_;
+  std::optional<int64_t> length_;
+  std::string name_;
+  int64_t piece_length_{};
+  std::string pieces_;
+};
+
+struct Torrent {
+  std::string announce_;
+  std::string comment_;
+  std::string created_by_;
+  int64_t creation_date_{};
+  TorrentInfo info_;
+};
+
+} // namespace
+
+template <> struct bencode::FieldMap<TorrentFile> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("length", &TorrentFile::length_),
+                      Field("path", &TorrentFile::path_));
+};
+
+template <> struct bencode::FieldMap<TorrentInfo> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("files", &TorrentInfo::files_),
+                      Field("length", &TorrentInfo::length_),
+                      Field("name", &TorrentInfo::name_),
+                      Field("piece length", &TorrentInfo::piece_length_),
+                      Field("pieces", &TorrentInfo::pieces_));
+};
+
+template <> struct bencode::FieldMap<Torrent> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("announce", &Torrent::announce_),
+                      Field("comment", &Torrent::comment_),
+                      Field("created by", &Torrent::created_by_),
+                      Field("creation date", &Torrent::creation_date_),
+                      Field("info", &Torrent::info_));
+};
+
+namespace {
+
+// the DOM path the binding replaces, every member looked up by key
+void CopyString(const bencode::Value &dict, const std::string_view key,
+                std::string &out) {
+  if (const auto it = dict.FindMember(key); it != dict.MemberEnd()) {
+    out = it->value_.GetString();
+  }
+}
+
+void CopyInteger(const bencode::Value &dict, const std::string_view key,
+                 int64_t &out) {
+  if (const auto it = dict.FindMember(key); it != dict.MemberEnd()) {
+    out = it->value_.GetInteger();
+  }
+}
+
+Torrent FromDocument(const bencode::Value &value) {
+  Torrent torrent;
+  CopyString(value, "announce", torrent.announce_);
+  CopyString(value, "comment", torrent.comment_);
+  CopyString(value, "created by", torrent.created_by_);
+  CopyInteger(value, "creation date", torrent.creation_date_);
+
+  const auto &info = value.FindMember("info")->value_;
+  if (const auto files = info.FindMember("files"); files != info.MemberEnd()) {
+    for (const auto &file : *files->value_.GetList()) {
+      auto &out = torrent.info_.files_.emplace_back();
+      CopyInteger(file, "length", out.length_);
+      for (const auto &path : *file.FindMember("path")->value_.GetList()) {
+        out.path_.push_back(path.GetString());
+      }
+    }
+  }
+  if (const auto it = info.FindMember("length"); it != info.MemberEnd()) {
+    torrent.info_.length_ = it->value_.GetInteger();
+  }
+  CopyString(info, "name", torrent.info_.name_);
+  CopyInteger(info, "piece length", torrent.info_.piece_length_);
+  CopyString(info, "pieces", torrent.info_.pieces_);
+  return torrent;
+}
+
+// the DOM path WriteTo replaces, the struct is copied into a Value first
+bencode::Value ToValue(const Torrent &torrent) {
+  auto info = bencode::Value(bencode::Type::B_DICT);
+  if (!torrent.info_.files_.empty()) {
+    auto files = bencode::Value(bencode::Type::B_LIST);
+    for (const auto &file : torrent.info_.files_) {
+      auto out = bencode::Value(bencode::Type::B_DICT);
+      out.AddMember("length", file.length_);
+      auto path = bencode::Value(bencode::Type::B_LIST);
+      for (const auto &p : file.path_) {
+        path.AddValue(p);
+      }
+      out.AddMember("path", std::move(path));
+      files.AddValue(std::move(out));
+    }
+    info.AddMember("files", std::move(files));
+  }
+  if (torrent.info_.length_) {
+    info.AddMember("length", *torrent.info_.length_);
+  }
+  info.AddMember("name", torrent.info_.name_);
+  info.AddMember("piece length", torrent.info_.piece_length_);
+  info.AddMember("pieces", torrent.info_.pieces_);
+
+  auto value = bencode::Value(bencode::Type::B_DICT);
+  value.AddMember("announce", torrent.announce_);
+  value.AddMember("comment", torrent.comment_);
+  value.AddMember("created by", torrent.created_by_);
+  value.AddMember("creation date", torrent.creation_date_);
+  value.AddMember("info", std::move(info));
+  return value;
+}
+
+} // namespace
+
+static void BM_bind_struct(benchmark::State &state,
+                           const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      Torrent out;
+      benchmark::DoNotOptimize(bencode::ParseInto(torrent, out));
+      benchmark::DoNotOptimize(out);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_bind_document(benchmark::State &state,
+                             const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::Document doc;
+      doc.Parse(torrent);
+      auto out = FromDocument(doc);
+      benchmark::DoNotOptimize(out);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_write_struct(benchmark::State &state,
+                            const std::filesystem::path &path) {
+  Torrent torrent;
+  bencode::ParseInto(ReadFile(path), torrent);
+
+  std::size_t bytes = 0;
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringWriteStream os;
+      bencode::BatchWriter writer(os);
+      bencode::WriteTo(torrent, writer);
+      bytes = os.get().size();
+      benchmark::DoNotOptimize(os.get());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+static void BM_write_value(benchmark::State &state,
+                           const std::filesystem::path &path) {
+  Torrent torrent;
+  bencode::ParseInto(ReadFile(path), torrent);
+
+  std::size_t bytes = 0;
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringWriteStream os;
+      bencode::BatchWriter writer(os);
+      ToValue(torrent).WriteTo(writer);
+      bytes = os.get().size();
+      benchmark::DoNotOptimize(os.get());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+static void BM_pieces_span(benchmark::State &state,
+                           const std::filesystem::path &path) {
+  const auto doc = Load(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      const auto pieces = bencode::Metainfo(doc).Pieces();
+      benchmark::DoNotOptimize(pieces[pieces.size() / 2]);
+    }
+  }
+}
+
+static void BM_pieces_copy(benchmark::State &state,
+                           const std::filesystem::path &path) {
+  const auto doc = Load(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      const auto pieces = doc["info"]["pieces"].GetString();
+      benchmark::DoNotOptimize(pieces[pieces.size() / 2]);
+    }
+  }
+}
+
 static void BM_decode_value(benchmark::State &state,
                             const std::filesystem::path &path) {
   auto ifs = std::ifstream(path, std::ifstream::binary);
+  if (!ifs.is_open()) {
+    state.SkipWithError("can not open the input file");
+    return;
+  }
   const std::string torrent(std::istreambuf_iterator<char>{ifs},
                             std::istreambuf_iterator<char>{});
 
-  for (auto _ : state) {
-    benchmark::DoNotOptimize(bencode::Document().Parse(torrent));
-    benchmark::ClobberMemory();
+  {
+    allocations::Scope scope(state);
+    perf::Scope counters(state, torrent.size());
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::Document().Parse(torrent));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_decode_iterative(benchmark::State &state,
+                                const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringReadStream rs(torrent);
+      bencode::Document doc;
+      benchmark::DoNotOptimize(bencode::Reader::IterativeParse(rs, doc));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_decode_key_table(benchmark::State &state,
+                                const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+  bencode::KeyTable keys;
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::Document(keys).Parse(torrent));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_decode_string_stream(benchmark::State &state,
+                                    const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringReadStream rs(torrent);
+      benchmark::DoNotOptimize(bencode::Document().ParseStream(rs));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_decode_file_stream(benchmark::State &state,
+                                  const std::filesystem::path &path) {
+  std::FILE *fp = std::fopen(path.c_str(), "rb");
+  if (fp == nullptr) {
+    state.SkipWithError("can not open the input file");
+    return;
+  }
+  std::vector<char> buffer(static_cast<std::size_t>(state.range(0)));
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      std::rewind(fp);
+      bencode::FileReadStream rs(fp, buffer.data(), buffer.size());
+      benchmark::DoNotOptimize(bencode::Document().ParseStream(rs));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          std::filesystem::file_size(path));
+  std::fclose(fp);
+}
+
+static void BM_decode_ifstream(benchmark::State &state,
+                               const std::filesystem::path &path) {
+  auto ifs = std::ifstream(path, std::ifstream::binary);
+  DecodeIStream(state, ifs, std::filesystem::file_size(path));
+}
+
+static void BM_decode_stringstream(benchmark::State &state,
+                                   const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+  std::stringstream ss(torrent);
+  DecodeIStream(state, ss, torrent.size());
+}
+
+static void BM_verify_canonical(benchmark::State &state,
+                                const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::VerifyCanonical(torrent));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+// what VerifyCanonical replaces: parse, re-encode and compare
+static void BM_verify_round_trip(benchmark::State &state,
+                                 const std::filesystem::path &path) {
+  const auto torrent = ReadFile(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::Document doc;
+      doc.Parse(torrent);
+      bencode::StringWriteStream os;
+      bencode::BatchWriter writer(os);
+      doc.WriteTo(writer);
+      benchmark::DoNotOptimize(os.get() == torrent);
+    }
   }
   state.SetBytesProcessed(state.iterations() * torrent.size());
 }
 
+static void BM_encode_string(benchmark::State &state,
+                             const std::filesystem::path &path) {
+  const auto doc = Load(path);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringWriteStream os;
+      bencode::BatchWriter writer(os);
+      doc.WriteTo(writer);
+      benchmark::DoNotOptimize(os.get());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * EncodedSize(doc));
+}
+
+static void BM_encode_file_null(benchmark::State &state,
+                                const std::filesystem::path &path) {
+  EncodeToFile(state, path, std::fopen("/dev/null", "wb"));
+}
+
+static void BM_encode_file_tmpfs(benchmark::State &state,
+                                 const std::filesystem::path &path) {
+  // /dev/shm is tmpfs on linux, elsewhere fall back to the temp directory
+  std::filesystem::path dir = "/dev/shm";
+  if (!std::filesystem::is_directory(dir)) {
+    dir = std::filesystem::temp_directory_path();
+  }
+  const auto out = dir / ("bencode_" + path.filename().string());
+  EncodeToFile(state, path, std::fopen(out.c_str(), "wb"));
+  std::filesystem::remove(out);
+}
+
+static void BM_encode_ostream(benchmark::State &state,
+                              const std::filesystem::path &path) {
+  const auto doc = Load(path);
+  std::ostringstream oss;
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      oss.seekp(0);
+      bencode::OStreamWrapper os(oss);
+      bencode::BatchWriter writer(os);
+      doc.WriteTo(writer);
+      os.flush();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * EncodedSize(doc));
+}
+
 BENCHMARK_CAPTURE(BM_decode_value, "ubuntu", resource::ubuntu);
 BENCHMARK_CAPTURE(BM_decode_value, "covid", resource::covid);
 BENCHMARK_CAPTURE(BM_decode_value, "camelyon17", resource::camelyon17);
 BENCHMARK_CAPTURE(BM_decode_value, "pneumonia", resource::pneumonia);
+BENCHMARK_CAPTURE(BM_decode_value, "debian", resource::debian);
+BENCHMARK_CAPTURE(BM_decode_value, "fedora", resource::fedora);
 BENCHMARK_CAPTURE(BM_decode_value, "integers", resource::integers);
 
+// registers func once per file in benchmark/resources, the trailing arguments
+// are applied to every registration
+#define BENCHMARK_RESOURCES(func, ...)                                         \
+  BENCHMARK_CAPTURE(func, "ubuntu", resource::ubuntu) __VA_ARGS__;             \
+  BENCHMARK_CAPTURE(func, "covid", resource::covid) __VA_ARGS__;               \
+  BENCHMARK_CAPTURE(func, "pneumonia", resource::pneumonia) __VA_ARGS__;       \
+  BENCHMARK_CAPTURE(func, "debian", resource::debian) __VA_ARGS__;             \
+  BENCHMARK_CAPTURE(func, "fedora", resource::fedora) __VA_ARGS__;             \
+  BENCHMARK_CAPTURE(func, "integers", resource::integers) __VA_ARGS__
+
+BENCHMARK_RESOURCES(BM_decode_iterative);
+BENCHMARK_RESOURCES(BM_decode_key_table);
+BENCHMARK_RESOURCES(BM_decode_string_stream);
+// buffer sizes 256, 4K, 64K and 1M
+BENCHMARK_RESOURCES(BM_decode_file_stream, ->RangeMultiplier(16)
+                                               ->Range(256, 1 << 20));
+BENCHMARK_RESOURCES(BM_decode_ifstream);
+BENCHMARK_RESOURCES(BM_decode_stringstream);
+
+#define BENCHMARK_TORRENTS(func)                                               \
+  BENCHMARK_CAPTURE(func, "ubuntu", resource::ubuntu);                         \
+  BENCHMARK_CAPTURE(func, "covid", resource::covid);                           \
+  BENCHMARK_CAPTURE(func, "pneumonia", resource::pneumonia);                   \
+  BENCHMARK_CAPTURE(func, "debian", resource::debian);                         \
+  BENCHMARK_CAPTURE(func, "fedora", resource::fedora)
+
+BENCHMARK_TORRENTS(BM_bind_struct);
+BENCHMARK_TORRENTS(BM_bind_document);
+BENCHMARK_TORRENTS(BM_write_struct);
+BENCHMARK_TORRENTS(BM_write_value);
+// the pieces string of the debian torrent is truncated, Pieces() rejects it
+BENCHMARK_CAPTURE(BM_pieces_span, "ubuntu", resource::ubuntu);
+BENCHMARK_CAPTURE(BM_pieces_span, "covid", resource::covid);
+BENCHMARK_CAPTURE(BM_pieces_span, "pneumonia", resource::pneumonia);
+BENCHMARK_CAPTURE(BM_pieces_span, "fedora", resource::fedora);
+BENCHMARK_TORRENTS(BM_pieces_copy);
+
+BENCHMARK_RESOURCES(BM_verify_canonical);
+BENCHMARK_RESOURCES(BM_verify_round_trip);
+
+BENCHMARK_RESOURCES(BM_encode_string);
+BENCHMARK_RESOURCES(BM_encode_file_null);
+BENCHMARK_RESOURCES(BM_encode_file_tmpfs);
+BENCHMARK_RESOURCES(BM_encode_ostream);
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,114 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bencode/internal/itoa.h"
+
+namespace {
+
+std::vector<int64_t> RandomIntegers(const int64_t range) {
+  std::mt19937_64 gen(42);
+  std::uniform_int_distribution<int64_t> dis(-range, range);
+  std::vector<int64_t> values(1024);
+  for (auto &v : values) {
+    v = dis(gen);
+  }
+  return values;
+}
+
+std::vector<int64_t> RandomIntegers(const benchmark::State &state) {
+  return RandomIntegers(state.range(0) == 0 ? INT64_MAX : state.range(0));
+}
+
+} // namespace
+
+static void BM_u64toa_lut(benchmark::State &state) {
+  const auto values = RandomIntegers(state);
+  char buf[bencode::internal::kItoaBufferSize];
+  for (auto _ : state) {
+    for (const auto v : values) {
+      benchmark::DoNotOptimize(
+          bencode::internal::u64toa_lut(static_cast<uint64_t>(v), buf));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+#if defined(BENCODE_SSE2)
+static void BM_u64toa_sse2(benchmark::State &state) {
+  const auto values = RandomIntegers(state);
+  char buf[bencode::internal::kItoaBufferSize];
+  for (auto _ : state) {
+    for (const auto v : values) {
+      benchmark::DoNotOptimize(
+          bencode::internal::u64toa_sse2(static_cast<uint64_t>(v), buf));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+#endif
+
+static void BM_i64toa_each(benchmark::State &state) {
+  const auto values = RandomIntegers(state);
+  std::vector<char> buf(values.size() *
+                        bencode::internal::kMaxEncodedIntegerSize);
+  for (auto _ : state) {
+    char *p = buf.data();
+    for (const auto v : values) {
+      *p++ = 'i';
+      p = bencode::internal::i64toa(v, p);
+      *p++ = 'e';
+    }
+    benchmark::DoNotOptimize(p);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+static void BM_i64toa_list(benchmark::State &state) {
+  const auto values = RandomIntegers(state);
+  std::vector<char> buf(values.size() *
+                        bencode::internal::kMaxEncodedIntegerSize);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        bencode::internal::i64toa_list(values, buf.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+// 0 selects the full int64_t range
+BENCHMARK(BM_u64toa_lut)->Arg(100)->Arg(100000000)->Arg(0);
+#if defined(BENCODE_SSE2)
+BENCHMARK(BM_u64toa_sse2)->Arg(100)->Arg(100000000)->Arg(0);
+#endif
+BENCHMARK(BM_i64toa_each)->Arg(100)->Arg(100000000)->Arg(0);
+BENCHMARK(BM_i64toa_list)->Arg(100)->Arg(100000000)->Arg(0);
+
+BENCHMARK_MAIN();
@@ -32,17 +32,44 @@
 
 #include "jimporter_bencode.h"
 
+#include "allocations.h"
+#include "perf_counters.h"
 #include "resources.h"
 
 static void BM_decode_value(benchmark::State &state,
                             const std::filesystem::path &path) {
   auto ifs = std::ifstream(path, std::ifstream::binary);
+  if (!ifs.is_open()) {
+    state.SkipWithError("can not open the input file");
+    return;
+  }
   std::string torrent(std::istreambuf_iterator<char>{ifs},
                       std::istreambuf_iterator<char>{});
 
-  for (auto _ : state) {
-    benchmark::DoNotOptimize(bencode::decode(torrent));
-    benchmark::ClobberMemory();
+  {
+    allocations::Scope scope(state);
+    perf::Scope counters(state, torrent.size());
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::decode(torrent));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * torrent.size());
+}
+
+static void BM_encode_value(benchmark::State &state,
+                            const std::filesystem::path &path) {
+  auto ifs = std::ifstream(path, std::ifstream::binary);
+  std::string torrent(std::istreambuf_iterator<char>{ifs},
+                      std::istreambuf_iterator<char>{});
+  const auto data = bencode::decode(torrent);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::encode(data));
+      benchmark::ClobberMemory();
+    }
   }
   state.SetBytesProcessed(state.iterations() * torrent.size());
 }
@@ -64,8 +91,17 @@ BENCHMARK_CAPTURE(BM_decode_value, "ubuntu", resource::ubuntu);
 BENCHMARK_CAPTURE(BM_decode_value, "covid", resource::covid);
 BENCHMARK_CAPTURE(BM_decode_value, "camelyon17", resource::camelyon17);
 BENCHMARK_CAPTURE(BM_decode_value, "pneumonia", resource::pneumonia);
+BENCHMARK_CAPTURE(BM_decode_value, "debian", resource::debian);
+BENCHMARK_CAPTURE(BM_decode_value, "fedora", resource::fedora);
 BENCHMARK_CAPTURE(BM_decode_value, "integers", resource::integers);
 
+BENCHMARK_CAPTURE(BM_encode_value, "ubuntu", resource::ubuntu);
+BENCHMARK_CAPTURE(BM_encode_value, "covid", resource::covid);
+BENCHMARK_CAPTURE(BM_encode_value, "pneumonia", resource::pneumonia);
+BENCHMARK_CAPTURE(BM_encode_value, "debian", resource::debian);
+BENCHMARK_CAPTURE(BM_encode_value, "fedora", resource::fedora);
+BENCHMARK_CAPTURE(BM_encode_value, "integers", resource::integers);
+
 // BENCHMARK_CAPTURE(BM_decode_view, "ubuntu", resource::ubuntu);
 // BENCHMARK_CAPTURE(BM_decode_view, "covid", resource::covid);
 // BENCHMARK_CAPTURE(BM_decode_view, "camelyon17", resource::camelyon17);
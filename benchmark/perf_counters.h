@@ -0,0 +1,161 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_BENCHMARK_PERF_COUNTERS_H
+#define BENCODE_BENCHMARK_PERF_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <iterator>
+
+#include <benchmark/benchmark.h>
+
+// Hardware counters read with perf_event_open(2), reported per byte. Built in
+// when BENCODE_BENCHMARK_PERF_COUNTERS is defined on linux, every counter the
+// kernel refuses (no PMU in the container, perf_event_paranoid, ...) is left
+// out of the report and the benchmark itself runs as usual.
+
+#if defined(BENCODE_BENCHMARK_PERF_COUNTERS) && defined(__linux__)
+#define BENCODE_BENCHMARK_PERF_ENABLED
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+#if defined(BENCODE_BENCHMARK_PERF_ENABLED)
+
+namespace internal {
+
+struct Event {
+  const char *name_;
+  uint32_t type_;
+  uint64_t config_;
+};
+
+constexpr uint64_t CacheMiss(const uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr Event kEvents[] = {
+    {"cycles/B", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions/B", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch-misses/B", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"L1d-misses/B", PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+    {"LLC-misses/B", PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL)},
+};
+constexpr std::size_t kEventCount = std::size(kEvents);
+
+inline int Open(const Event &event) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = event.type_;
+  attr.config = event.config_;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+/**
+ * @brief reads a counter and scales it up when the kernel multiplexed it,
+ * returns a negative value when there is nothing to report
+ */
+inline double Read(const int fd) {
+  uint64_t values[3]{};
+  if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+    return -1;
+  }
+  return static_cast<double>(values[0]) * static_cast<double>(values[1]) /
+         static_cast<double>(values[2]);
+}
+
+} // namespace internal
+
+/**
+ * @brief counts cycles, instructions, branch misses and L1d/LLC read misses
+ * of the calling thread while it is alive and reports each divided by the
+ * bytes processed
+ */
+class Scope {
+  benchmark::State &state_;
+  std::size_t bytes_;
+  int fds_[internal::kEventCount]{};
+
+public:
+  Scope(benchmark::State &state, const std::size_t bytes_per_iteration)
+      : state_(state), bytes_(bytes_per_iteration) {
+    for (std::size_t i = 0; i < internal::kEventCount; ++i) {
+      fds_[i] = internal::Open(internal::kEvents[i]);
+    }
+    for (const int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  ~Scope() {
+    for (const int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+
+    const auto bytes =
+        static_cast<double>(state_.iterations()) * static_cast<double>(bytes_);
+    for (std::size_t i = 0; i < internal::kEventCount; ++i) {
+      if (fds_[i] < 0) {
+        continue;
+      }
+      if (const double value = internal::Read(fds_[i]);
+          value >= 0 && bytes > 0) {
+        state_.counters[internal::kEvents[i].name_] = value / bytes;
+      }
+      close(fds_[i]);
+    }
+  }
+};
+
+#else
+
+class Scope {
+public:
+  Scope(benchmark::State &, std::size_t) {}
+};
+
+#endif // BENCODE_BENCHMARK_PERF_ENABLED
+
+} // namespace perf
+
+#endif // BENCODE_BENCHMARK_PERF_COUNTERS_H
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (c) 2024 HominSu
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Benchmark regression gate.
+
+Runs the in-tree benchmark suite and the jimporter reference suite with JSON
+output and repetitions, then compares every case listed in the baseline file.
+
+Each case is judged on its fastest repetition, since noise on a shared host
+only ever adds time. By default, as set by "mode" in the baseline, that time
+is compared with the time stored in the baseline, which only holds on the
+machine that recorded it. A case fails when it is slower than the baseline by
+more than its tolerance, widened to three times the noise (coefficient of
+variation) measured over the repetitions.
+
+--ratio judges the time relative to the matching reference case instead, which
+survives a hardware change but drifts with the compiler, the flags and the host
+even when neither library changed, so it is a coarse check only.
+
+The baseline must be recorded on the machine that runs the gate:
+
+  1. build both suites in Release on the gating machine
+  2. regression_gate.py --suite ... --reference ... --update
+  3. commit benchmark/baseline.json
+
+usage:
+  regression_gate.py --suite hominsu_bencode --reference jimporter_bencode
+  regression_gate.py ... --update # rewrite the baseline from this run
+  regression_gate.py ... --ratio  # gate on the ratio to the reference
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(__file__), "baseline.json")
+NOISE_FACTOR = 3.0
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def run_suite(executable, bench_filter, repetitions):
+    """Runs one benchmark executable and returns {name: (fastest_ns, cv)}."""
+    cmd = [
+        executable,
+        "--benchmark_format=json",
+        "--benchmark_repetitions=%d" % repetitions,
+        "--benchmark_filter=%s" % bench_filter,
+    ]
+    output = subprocess.run(cmd, check=True, stdout=subprocess.PIPE).stdout
+    return collect(json.loads(output))
+
+
+def collect(report):
+    times = {}
+    for bench in report["benchmarks"]:
+        if bench.get("run_type") != "iteration" or bench.get("error_occurred"):
+            continue
+        value = bench["cpu_time"] * UNITS[bench.get("time_unit", "ns")]
+        times.setdefault(bench["run_name"], []).append(value)
+
+    result = {}
+    for name, values in times.items():
+        mean = sum(values) / len(values)
+        if mean <= 0:
+            continue
+        stddev = math.sqrt(sum((v - mean) ** 2 for v in values) / len(values))
+        result[name] = (min(values), stddev / mean)
+    return result
+
+
+def compare(baseline, suite, reference, absolute):
+    default_tolerance = baseline.get("tolerance", 0.15)
+    failed = 0
+    rows = []
+
+    for name, entry in sorted(baseline["benchmarks"].items()):
+        ref_name = entry.get("reference", name)
+        tolerance = entry.get("tolerance", default_tolerance)
+        if name not in suite or ref_name not in reference:
+            rows.append((name, "MISSING", "", "", ""))
+            failed += 1
+            continue
+
+        time, cv = suite[name]
+        ref_time, ref_cv = reference[ref_name]
+        ratio = time / ref_time
+        # noise of a ratio adds up from both of its sides
+        ratio_cv = math.hypot(cv, ref_cv)
+
+        if absolute:
+            delta = time / entry["time"] - 1
+            noise = cv
+        else:
+            delta = ratio / entry["ratio"] - 1
+            noise = ratio_cv
+        allowed = max(tolerance, NOISE_FACTOR * noise)
+        status = "FAIL" if delta > allowed else "ok"
+        failed += status == "FAIL"
+        rows.append((name, status, "%+.1f%%" % (delta * 100),
+                     "+-%.1f%%" % (noise * 100), "%.3f" % ratio))
+
+    widths = [max(len(row[i]) for row in rows + [HEADER]) for i in range(5)]
+    for row in [HEADER] + rows:
+        print("  ".join(col.ljust(width) for col, width in zip(row, widths)))
+    print("\n%d of %d cases failed" % (failed, len(rows)))
+    return failed == 0
+
+
+HEADER = ("benchmark", "status", "delta", "noise", "vs reference")
+
+
+def update(baseline, suite, reference):
+    for name, entry in baseline["benchmarks"].items():
+        ref_name = entry.get("reference", name)
+        if name in suite and ref_name in reference:
+            entry["time"] = round(suite[name][0], 1)
+            entry["ratio"] = round(suite[name][0] / reference[ref_name][0], 4)
+        else:
+            print("not measured: %s" % name, file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--suite", required=True,
+                        help="in-tree benchmark executable")
+    parser.add_argument("--reference", required=True,
+                        help="reference benchmark executable")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--repetitions", type=int, default=10)
+    mode = parser.add_mutually_exclusive_group()
+    mode.add_argument("--absolute", action="store_true",
+                      help="gate on absolute times, same machine only")
+    mode.add_argument("--ratio", action="store_true",
+                      help="gate on the ratio to the reference case")
+    parser.add_argument("--update", action="store_true",
+                        help="rewrite the baseline from this run")
+    args = parser.parse_args()
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    suite = run_suite(args.suite, baseline["suite_filter"], args.repetitions)
+    reference = run_suite(args.reference, baseline["reference_filter"],
+                          args.repetitions)
+
+    if args.update:
+        update(baseline, suite, reference)
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        return 0
+
+    absolute = args.absolute or (not args.ratio and
+                                 baseline.get("mode", "ratio") == "absolute")
+    return 0 if compare(baseline, suite, reference, absolute) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -36,6 +36,10 @@ static std::filesystem::path ubuntu =
 static std::filesystem::path covid =
     RESOURCES_DIR "/COVID-19-image-dataset-collection.torrent";
 static std::filesystem::path camelyon17 = RESOURCES_DIR "/CAMELYON17.torrent";
+static std::filesystem::path debian =
+    RESOURCES_DIR "/debian-12.5.0-amd64-DVD-1.iso.torrent";
+static std::filesystem::path fedora =
+    RESOURCES_DIR "/Fedora-Workstation-Live-x86_64-30.torrent";
 static std::filesystem::path integers = RESOURCES_DIR "/integers.bencode";
 static std::filesystem::path pneumonia =
     RESOURCES_DIR "/RSNA_Pneumonia_Detection_Challenge.torrent";
@@ -0,0 +1,194 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bencode/document.h"
+#include "bencode/reader.h"
+#include "bencode/string_read_stream.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "allocations.h"
+#include "workload/generator.h"
+
+// Sweeps one parameter of a synthetic document at a time to show how parse,
+// encode and lookup scale with its shape.
+
+namespace {
+
+// two-way tree, depth levels deep
+workload::Shape Depth(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = static_cast<std::size_t>(state.range(0));
+  shape.fan_out = 2;
+  return shape;
+}
+
+// chain of single-child containers
+workload::Shape Nesting(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = static_cast<std::size_t>(state.range(0));
+  shape.fan_out = 1;
+  return shape;
+}
+
+// a single list (range 1 is 0) or dict (range 1 is 1) of range 0 leaves
+workload::Shape FanOut(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = 1;
+  shape.fan_out = static_cast<std::size_t>(state.range(0));
+  shape.dict_ratio = static_cast<double>(state.range(1));
+  return shape;
+}
+
+// a dict of 1024 members with keys of range 0 bytes
+workload::Shape KeyLength(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = 1;
+  shape.fan_out = 1024;
+  shape.dict_ratio = 1;
+  shape.key_min = shape.key_max = static_cast<std::size_t>(state.range(0));
+  return shape;
+}
+
+// a list of 4 strings of range 0 bytes
+workload::Shape StringSize(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = 1;
+  shape.fan_out = 4;
+  shape.dict_ratio = 0;
+  shape.integer_ratio = 0;
+  shape.string_min = shape.string_max =
+      static_cast<std::size_t>(state.range(0));
+  return shape;
+}
+
+// a list of 65536 integers of range 0 decimal digits
+workload::Shape IntegerDigits(const benchmark::State &state) {
+  workload::Shape shape;
+  shape.depth = 1;
+  shape.fan_out = 65536;
+  shape.dict_ratio = 0;
+  shape.integer_ratio = 1;
+  shape.integer_digits = static_cast<std::size_t>(state.range(0));
+  return shape;
+}
+
+} // namespace
+
+template <workload::Shape (*MakeShape)(const benchmark::State &)>
+static void BM_parse(benchmark::State &state) {
+  const auto bencode = workload::Generate(MakeShape(state));
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(bencode::Document().Parse(bencode));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bencode.size());
+}
+
+template <workload::Shape (*MakeShape)(const benchmark::State &)>
+static void BM_parse_iterative(benchmark::State &state) {
+  const auto bencode = workload::Generate(MakeShape(state));
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringReadStream rs(bencode);
+      bencode::Document doc;
+      benchmark::DoNotOptimize(bencode::Reader::IterativeParse(rs, doc));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bencode.size());
+}
+
+template <workload::Shape (*MakeShape)(const benchmark::State &)>
+static void BM_encode(benchmark::State &state) {
+  const auto bencode = workload::Generate(MakeShape(state));
+  bencode::Document doc;
+  doc.Parse(bencode);
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      bencode::StringWriteStream os;
+      bencode::BatchWriter writer(os);
+      doc.WriteTo(writer);
+      benchmark::DoNotOptimize(os.get());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bencode.size());
+}
+
+template <workload::Shape (*MakeShape)(const benchmark::State &)>
+static void BM_lookup(benchmark::State &state) {
+  auto shape = MakeShape(state);
+  shape.dict_ratio = 1;
+  bencode::Document doc;
+  doc.Parse(workload::Generate(shape));
+
+  std::vector<std::string> keys;
+  for (auto it = doc.MemberBegin(); it != doc.MemberEnd(); ++it) {
+    keys.push_back(it->key_.GetString());
+  }
+
+  {
+    allocations::Scope scope(state);
+    for (auto _ : state) {
+      for (const auto &key : keys) {
+        benchmark::DoNotOptimize(doc.FindMember(key));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+#define BENCHMARK_SHAPE(func)                                                  \
+  BENCHMARK_TEMPLATE(func, Depth)->DenseRange(4, 16, 4);                       \
+  BENCHMARK_TEMPLATE(func, Nesting)->RangeMultiplier(4)->Range(16, 1024);      \
+  BENCHMARK_TEMPLATE(func, FanOut)                                             \
+      ->ArgsProduct({benchmark::CreateRange(16, 1 << 20, 64), {0, 1}});        \
+  BENCHMARK_TEMPLATE(func, KeyLength)->RangeMultiplier(16)->Range(1, 256);     \
+  BENCHMARK_TEMPLATE(func, StringSize)->RangeMultiplier(64)->Range(16, 1 << 22)
+
+BENCHMARK_SHAPE(BM_parse);
+BENCHMARK_TEMPLATE(BM_parse, IntegerDigits)->Arg(1)->Arg(4)->Arg(9)->Arg(18);
+BENCHMARK_SHAPE(BM_parse_iterative);
+BENCHMARK_SHAPE(BM_encode);
+BENCHMARK_TEMPLATE(BM_encode, IntegerDigits)->Arg(1)->Arg(4)->Arg(9)->Arg(18);
+
+// lookups always run against a dict
+BENCHMARK_TEMPLATE(BM_lookup, FanOut)
+    ->Args({16, 1})
+    ->Args({1024, 1})
+    ->Args({4096, 1});
+BENCHMARK_TEMPLATE(BM_lookup, KeyLength)->RangeMultiplier(16)->Range(1, 256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,131 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "generator.h"
+
+namespace {
+
+void Usage(const char *name) {
+  std::fprintf(
+      stderr,
+      "usage: %s [options] [-o FILE]\n"
+      "writes a synthetic bencode document to FILE or stdout\n"
+      "  --seed=N            random seed (42)\n"
+      "  --depth=N           container levels above the leaves (3)\n"
+      "  --fan-out=N         children per list or dict (8)\n"
+      "  --dict-ratio=R      fraction of containers that are dicts (0.5)\n"
+      "  --key-min=N         shortest key (4)\n"
+      "  --key-max=N         longest key (16)\n"
+      "  --string-min=N      shortest string, log-uniform (1)\n"
+      "  --string-max=N      longest string, log-uniform (64)\n"
+      "  --integer-ratio=R   fraction of leaves that are integers (0.5)\n"
+      "  --integer-digits=N  integer magnitude in decimal digits (9)\n"
+      "  --unsorted-keys     emit dict keys in generation order\n",
+      name);
+}
+
+template <typename T> bool ParseNumber(const std::string &str, T &value) {
+  char *end = nullptr;
+  if constexpr (std::is_floating_point_v<T>) {
+    value = std::strtod(str.c_str(), &end);
+  } else {
+    value = static_cast<T>(std::strtoull(str.c_str(), &end, 10));
+  }
+  return !str.empty() && *end == '\0';
+}
+
+bool ParseOption(const std::string_view arg, workload::Shape &shape) {
+  const auto eq = arg.find('=');
+  const auto name = arg.substr(0, eq);
+  if (eq == std::string_view::npos) {
+    if (name == "--unsorted-keys") {
+      shape.sorted_keys = false;
+      return true;
+    }
+    return false;
+  }
+
+  const std::string value(arg.substr(eq + 1));
+  if (name == "--seed") {
+    return ParseNumber(value, shape.seed);
+  } else if (name == "--depth") {
+    return ParseNumber(value, shape.depth);
+  } else if (name == "--fan-out") {
+    return ParseNumber(value, shape.fan_out);
+  } else if (name == "--dict-ratio") {
+    return ParseNumber(value, shape.dict_ratio);
+  } else if (name == "--key-min") {
+    return ParseNumber(value, shape.key_min);
+  } else if (name == "--key-max") {
+    return ParseNumber(value, shape.key_max);
+  } else if (name == "--string-min") {
+    return ParseNumber(value, shape.string_min);
+  } else if (name == "--string-max") {
+    return ParseNumber(value, shape.string_max);
+  } else if (name == "--integer-ratio") {
+    return ParseNumber(value, shape.integer_ratio);
+  } else if (name == "--integer-digits") {
+    return ParseNumber(value, shape.integer_digits);
+  }
+  return false;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  workload::Shape shape;
+  const char *output = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (!ParseOption(argv[i], shape)) {
+      Usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (shape.key_min > shape.key_max || shape.string_min > shape.string_max) {
+    std::fprintf(stderr, "min must not be greater than max\n");
+    return EXIT_FAILURE;
+  }
+
+  const auto bencode = workload::Generate(shape);
+  if (output == nullptr) {
+    std::cout.write(bencode.data(),
+                    static_cast<std::streamsize>(bencode.size()));
+    return std::cout ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  std::ofstream ofs(output, std::ofstream::binary);
+  ofs.write(bencode.data(), static_cast<std::streamsize>(bencode.size()));
+  return ofs ? EXIT_SUCCESS : EXIT_FAILURE;
+}
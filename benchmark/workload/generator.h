@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright (c) 2024 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_BENCHMARK_WORKLOAD_GENERATOR_H
+#define BENCODE_BENCHMARK_WORKLOAD_GENERATOR_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace workload {
+
+/**
+ * @brief parameters of a synthetic document, containers nest depth levels
+ * deep with fan_out children each and every leaf is an integer or a string
+ */
+struct Shape {
+  uint64_t seed = 42;
+  // levels of containers above the leaves, zero produces a single leaf
+  std::size_t depth = 3;
+  // children per list and members per dict
+  std::size_t fan_out = 8;
+  // fraction of containers that are dicts, the rest are lists
+  double dict_ratio = 0.5;
+  // key lengths are uniform in [key_min, key_max]
+  std::size_t key_min = 4;
+  std::size_t key_max = 16;
+  // string lengths are log-uniform in [string_min, string_max]
+  std::size_t string_min = 1;
+  std::size_t string_max = 64;
+  // fraction of leaves that are integers, the rest are strings
+  double integer_ratio = 0.5;
+  // integers are uniform in [-10^digits + 1, 10^digits - 1], at most 18
+  std::size_t integer_digits = 9;
+  // emit dict keys in byte order as canonical bencode requires
+  bool sorted_keys = true;
+};
+
+/**
+ * @brief writes bencode documents of a given Shape, the same seed gives the
+ * same bytes as long as the standard library stays the same
+ */
+class Generator {
+  Shape shape_;
+  std::mt19937_64 gen_;
+  std::string out_;
+
+public:
+  explicit Generator(const Shape &shape)
+      : shape_(shape), gen_(shape.seed), out_() {}
+
+  std::string Generate() {
+    out_.clear();
+    Node(shape_.depth);
+    return std::move(out_);
+  }
+
+private:
+  std::size_t Uniform(const std::size_t min, const std::size_t max) {
+    return std::uniform_int_distribution<std::size_t>(min, max)(gen_);
+  }
+
+  bool Chance(const double ratio) {
+    return std::uniform_real_distribution<double>(0, 1)(gen_) < ratio;
+  }
+
+  void Node(const std::size_t depth) {
+    if (depth == 0) {
+      Chance(shape_.integer_ratio) ? Integer() : String();
+    } else if (Chance(shape_.dict_ratio)) {
+      Dict(depth - 1);
+    } else {
+      List(depth - 1);
+    }
+  }
+
+  void Integer() {
+    const auto digits = std::min<std::size_t>(shape_.integer_digits, 18);
+    int64_t limit = 1;
+    for (std::size_t i = 0; i < digits; ++i) {
+      limit *= 10;
+    }
+    --limit;
+    out_ += 'i';
+    out_ += std::to_string(std::uniform_int_distribution<int64_t>(
+        -limit, limit)(gen_));
+    out_ += 'e';
+  }
+
+  void String() {
+    const double lo = std::log(static_cast<double>(shape_.string_min) + 1);
+    const double hi = std::log(static_cast<double>(shape_.string_max) + 1);
+    const auto length = static_cast<std::size_t>(
+        std::exp(std::uniform_real_distribution<double>(lo, hi)(gen_)) - 1);
+    Bytes(std::clamp(length, shape_.string_min, shape_.string_max));
+  }
+
+  void Bytes(const std::size_t length) {
+    out_ += std::to_string(length);
+    out_ += ':';
+    std::uniform_int_distribution<int> dis('a', 'z');
+    for (std::size_t i = 0; i < length; ++i) {
+      out_ += static_cast<char>(dis(gen_));
+    }
+  }
+
+  void List(const std::size_t depth) {
+    out_ += 'l';
+    for (std::size_t i = 0; i < shape_.fan_out; ++i) {
+      Node(depth);
+    }
+    out_ += 'e';
+  }
+
+  void Dict(const std::size_t depth) {
+    // keys must be unique, short lengths may not have fan_out of them
+    std::set<std::string> unique;
+    std::vector<std::string> keys;
+    std::uniform_int_distribution<int> dis('a', 'z');
+    while (keys.size() < shape_.fan_out) {
+      std::string key(Uniform(shape_.key_min, shape_.key_max), '\0');
+      for (auto &ch : key) {
+        ch = static_cast<char>(dis(gen_));
+      }
+      if (!unique.insert(key).second) {
+        key += std::to_string(keys.size());
+        if (!unique.insert(key).second) {
+          continue;
+        }
+      }
+      keys.push_back(std::move(key));
+    }
+    if (shape_.sorted_keys) {
+      std::sort(keys.begin(), keys.end());
+    }
+
+    out_ += 'd';
+    for (const auto &key : keys) {
+      out_ += std::to_string(key.size());
+      out_ += ':';
+      out_ += key;
+      Node(depth);
+    }
+    out_ += 'e';
+  }
+};
+
+inline std::string Generate(const Shape &shape) {
+  return Generator(shape).Generate();
+}
+
+} // namespace workload
+
+#endif // BENCODE_BENCHMARK_WORKLOAD_GENERATOR_H
@@ -24,15 +24,12 @@
 // Created by Homin Su on 2023/3/10.
 //
 
-#include <cassert>
 #include <cstdio>
 
-#include <memory>
 #include <string>
 
-#include "bencode/document.h"
+#include "bencode/binding.h"
 #include "bencode/file_write_stream.h"
-#include "bencode/value.h"
 #include "bencode/writer.h"
 #include "sample.h"
 
@@ -48,55 +45,42 @@ struct TorrentFile {
   std::string comment_;
   int64_t creation_date_{};
   Info info_;
+};
 
-  explicit TorrentFile(const bencode::Value &val) {
-    assert(val.GetType() == bencode::Type::B_DICT && "bad type");
-    announce_ = val["announce"].GetString();
-    comment_ = val["comment"].GetString();
-    creation_date_ = val["creation date"].GetInteger();
-
-    auto info = val["info"];
-    info_.length_ = info["length"].GetInteger();
-    info_.name_ = info["name"].GetString();
-    info_.piece_length_ = info["piece length"].GetInteger();
-    info_.pieces_ = info["pieces"].GetString();
-  }
+template <> struct bencode::FieldMap<TorrentFile::Info> {
+  using Info = TorrentFile::Info;
+  static constexpr auto kFields =
+      std::make_tuple(Field("length", &Info::length_),
+                      Field("name", &Info::name_),
+                      Field("piece length", &Info::piece_length_),
+                      Field("pieces", &Info::pieces_));
+};
 
-  [[nodiscard]] bencode::Value toBencode() const {
-    auto value = bencode::Value(bencode::Type::B_DICT);
-    value.AddMember("announce", announce_);
-    value.AddMember("comment", comment_);
-    value.AddMember("creation date", creation_date_);
-    auto info = bencode::Value(bencode::Type::B_DICT);
-    info.AddMember("length", info_.length_);
-    info.AddMember("name", info_.name_);
-    info.AddMember("piece length", info_.piece_length_);
-    info.AddMember("pieces", info_.pieces_);
-    value.AddMember("info", std::move(info));
-    return value;
-  }
+template <> struct bencode::FieldMap<TorrentFile> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("announce", &TorrentFile::announce_),
+                      Field("comment", &TorrentFile::comment_),
+                      Field("creation date", &TorrentFile::creation_date_),
+                      Field("info", &TorrentFile::info_));
 };
 
 int main(const int argc, char *argv[]) {
   (void)argc;
   (void)argv;
 
-  // 1. Parse a Bencode string into DOM.
-  bencode::Document doc;
-  if (const auto err = doc.Parse(kSample[0]); err != bencode::error::OK) {
+  // 1. Parse a Bencode string straight into the struct.
+  TorrentFile torrent_file;
+  if (const auto err = bencode::ParseInto(kSample[0], torrent_file);
+      err != bencode::error::OK) {
     puts(bencode::ParseErrorStr(err));
     return EXIT_FAILURE;
   }
 
-  // 2. Bind DOM to struct.
-  const auto torrent_file = TorrentFile(doc);
-
-  // 3. Convert struct to Bencode and output
-  const auto value = torrent_file.toBencode();
+  // 2. Write the struct back out as Bencode, keys in canonical order
   char writeBuffer[65536];
   bencode::FileWriteStream out(stdout, writeBuffer);
   bencode::Writer writer(out);
-  value.WriteTo(writer);
+  bencode::WriteTo(torrent_file, writer);
 
   return 0;
 }
\ No newline at end of file
@@ -69,6 +69,17 @@
 #define BENCODE_HAS_BUILTIN(x) 0
 #endif
 
+/**
+ * @brief simd, BENCODE_SSE2 is on wherever SSE2 is part of the target (every
+ * x86-64), define BENCODE_NO_SIMD to stay with the scalar code
+ */
+#if !defined(BENCODE_NO_SIMD) && !defined(BENCODE_SSE2)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) ||              \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BENCODE_SSE2 1
+#endif
+#endif
+
 #ifndef BENCODE_ASSERT
 #include <cassert>
 #define BENCODE_ASSERT(x) assert(x)
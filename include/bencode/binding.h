@@ -0,0 +1,511 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_BINDING_H_
+#define BENCODE_INCLUDE_BENCODE_BINDING_H_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bencode.h"
+#include "exception.h"
+#include "non_copyable.h"
+#include "reader.h"
+#include "string_read_stream.h"
+#include "value.h"
+
+namespace bencode {
+
+/**
+ * @brief one entry of a FieldMap, the dict key a member is read from
+ */
+template <typename Class, typename Member> struct Field {
+  std::string_view key_;
+  Member Class::*member_;
+
+  constexpr Field(const std::string_view key, Member Class::*member)
+      : key_(key), member_(member) {}
+};
+
+/**
+ * @brief declares how a struct maps to a dict, specialise it with the fields
+ * once and the struct can be parsed with ParseInto and written with WriteTo,
+ * the fields may be listed in any order
+ *
+ * @code
+ * template <> struct bencode::FieldMap<Info> {
+ *   static constexpr auto kFields = std::make_tuple(
+ *       bencode::Field("length", &Info::length_),
+ *       bencode::Field("name", &Info::name_));
+ * };
+ * @endcode
+ *
+ * Members can be integers, std::string, std::vector and std::optional of
+ * those, and other structs with a FieldMap.
+ */
+template <typename T> struct FieldMap;
+
+namespace required::binding {
+
+template <typename T>
+concept HasFieldMap = requires {
+  std::tuple_size<std::remove_cvref_t<decltype(FieldMap<T>::kFields)>>::value;
+};
+
+// the integer types std::in_range accepts
+template <typename T>
+concept Integer =
+    std::integral<T> && !std::same_as<T, bool> && !std::same_as<T, char> &&
+    !std::same_as<T, wchar_t> && !std::same_as<T, char8_t> &&
+    !std::same_as<T, char16_t> && !std::same_as<T, char32_t>;
+
+} // namespace required::binding
+
+namespace internal::binding {
+
+template <typename T> struct IsVector : std::false_type {};
+template <typename T, typename A>
+struct IsVector<std::vector<T, A>> : std::true_type {};
+
+template <typename T> struct IsOptional : std::false_type {};
+template <typename T> struct IsOptional<std::optional<T>> : std::true_type {};
+
+constexpr uint32_t Hash(const std::string_view key, const uint32_t seed) {
+  // FNV-1a with the seed folded into the offset basis
+  uint32_t hash = 2166136261U ^ seed;
+  for (const char ch : key) {
+    hash ^= static_cast<uint8_t>(ch);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+/**
+ * @brief collision free table from N keys to their index, the seed is found
+ * at compile time so a lookup is one hash, one load and one compare
+ */
+template <std::size_t N> class PerfectHash {
+  static_assert(N < 0xff, "too many fields for one struct");
+
+  static constexpr std::size_t kSize = std::bit_ceil(N + 1) * 8;
+  static constexpr uint8_t kEmpty = 0xff;
+  static constexpr uint32_t kMaxSeed = 1 << 16;
+
+  std::array<std::string_view, N> keys_;
+  std::array<uint8_t, kSize> table_{};
+  uint32_t seed_ = 0;
+
+public:
+  constexpr explicit PerfectHash(const std::array<std::string_view, N> &keys)
+      : keys_(keys) {
+    for (std::size_t i = 0; i < N; ++i) {
+      for (std::size_t j = i + 1; j < N; ++j) {
+        if (keys_[i] == keys_[j]) {
+          throw "duplicate key in FieldMap";
+        }
+      }
+    }
+    for (; seed_ < kMaxSeed; ++seed_) {
+      if (TrySeed()) {
+        return;
+      }
+    }
+    throw "no perfect hash found for FieldMap";
+  }
+
+  // index of key, N when it is not one of the keys
+  [[nodiscard]] constexpr std::size_t Find(const std::string_view key) const {
+    const uint8_t index = table_[Hash(key, seed_) & (kSize - 1)];
+    return index != kEmpty && keys_[index] == key ? index : N;
+  }
+
+private:
+  constexpr bool TrySeed() {
+    table_.fill(kEmpty);
+    for (std::size_t i = 0; i < N; ++i) {
+      auto &slot = table_[Hash(keys_[i], seed_) & (kSize - 1)];
+      if (slot != kEmpty) {
+        return false;
+      }
+      slot = static_cast<uint8_t>(i);
+    }
+    return true;
+  }
+};
+
+struct SlotOps;
+
+// where the next value goes, a null ops_ means the value is skipped
+struct Slot {
+  void *target_ = nullptr;
+  const SlotOps *ops_ = nullptr;
+};
+
+// an open list or dict, child_ gives the slot for a key, or for the next
+// element when the frame is a list
+struct Frame {
+  void *object_ = nullptr;
+  Slot (*child_)(void *object, std::string_view key) = nullptr;
+  bool is_dict_ = false;
+};
+
+// what a target type accepts, null members are type mismatches
+struct SlotOps {
+  // false when the integer does not fit the target
+  bool (*integer_)(void *target, int64_t i64) = nullptr;
+  std::string *(*string_)(void *target) = nullptr;
+  Frame (*list_)(void *target) = nullptr;
+  Frame (*dict_)(void *target) = nullptr;
+};
+
+template <typename T> constexpr SlotOps MakeSlotOps();
+
+template <typename T> inline constexpr SlotOps kSlotOps = MakeSlotOps<T>();
+
+template <typename T> Slot MakeSlot(T &target) {
+  if constexpr (IsOptional<T>::value) {
+    return MakeSlot(target.emplace());
+  } else {
+    return {&target, &kSlotOps<T>};
+  }
+}
+
+template <typename T, required::handler::HasAllRequiredFunctions Handler>
+bool Write(const T &value, Handler &handler);
+
+template <required::binding::HasFieldMap T> class StructBinding {
+  static constexpr auto &kFields = FieldMap<T>::kFields;
+  static constexpr std::size_t kCount =
+      std::tuple_size_v<std::remove_cvref_t<decltype(kFields)>>;
+
+  static constexpr auto kKeys = std::apply(
+      [](const auto &...field) {
+        return std::array<std::string_view, kCount>{field.key_...};
+      },
+      kFields);
+
+  static constexpr PerfectHash<kCount> kHash{kKeys};
+
+  // field indices in the byte order of their keys, the order a canonical
+  // dict is written in
+  static constexpr auto kOrder = [] {
+    std::array<std::size_t, kCount> order{};
+    for (std::size_t i = 0; i < kCount; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [](const auto lhs, const auto rhs) {
+      return kKeys[lhs] < kKeys[rhs];
+    });
+    return order;
+  }();
+
+  template <std::size_t I> static Slot SlotOf(void *object) {
+    return MakeSlot(static_cast<T *>(object)->*std::get<I>(kFields).member_);
+  }
+
+  static constexpr auto kSlots = []<std::size_t... I>(
+                                     std::index_sequence<I...>) {
+    return std::array<Slot (*)(void *), kCount>{&SlotOf<I>...};
+  }(std::make_index_sequence<kCount>{});
+
+  template <std::size_t I, required::handler::HasAllRequiredFunctions Handler>
+  static bool WriteField(const T &value, Handler &handler) {
+    const auto &field = std::get<I>(kFields);
+    const auto &member = value.*field.member_;
+    if constexpr (IsOptional<std::remove_cvref_t<decltype(member)>>::value) {
+      if (!member.has_value()) {
+        return true;
+      }
+    }
+    return handler.Key(field.key_) && Write(member, handler);
+  }
+
+public:
+  static Slot Child(void *object, const std::string_view key) {
+    const std::size_t index = kHash.Find(key);
+    return index < kCount ? kSlots[index](object) : Slot{};
+  }
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  static bool WriteDict(const T &value, Handler &handler) {
+    return handler.StartDict() &&
+           [&]<std::size_t... I>(std::index_sequence<I...>) {
+             return (WriteField<kOrder[I]>(value, handler) && ...);
+           }(std::make_index_sequence<kCount>{}) &&
+           handler.EndDict();
+  }
+};
+
+template <typename T> Slot VectorChild(void *object, std::string_view) {
+  return MakeSlot(static_cast<T *>(object)->emplace_back());
+}
+
+template <typename T> constexpr SlotOps MakeSlotOps() {
+  SlotOps ops;
+  if constexpr (required::binding::Integer<T>) {
+    ops.integer_ = [](void *target, const int64_t i64) {
+      if (!std::in_range<T>(i64)) {
+        return false;
+      }
+      *static_cast<T *>(target) = static_cast<T>(i64);
+      return true;
+    };
+  } else if constexpr (std::same_as<T, std::string>) {
+    ops.string_ = [](void *target) {
+      return static_cast<std::string *>(target);
+    };
+  } else if constexpr (IsVector<T>::value) {
+    ops.list_ = [](void *target) {
+      static_cast<T *>(target)->clear();
+      return Frame{target, &VectorChild<T>, false};
+    };
+  } else if constexpr (required::binding::HasFieldMap<T>) {
+    ops.dict_ = [](void *target) {
+      return Frame{target, &StructBinding<T>::Child, true};
+    };
+  } else {
+    static_assert(!sizeof(T), "no bencode binding for this member type");
+  }
+  return ops;
+}
+
+template <typename T, required::handler::HasAllRequiredFunctions Handler>
+bool Write(const T &value, Handler &handler) {
+  if constexpr (required::binding::Integer<T>) {
+    // an unsigned member may hold more than bencode can carry
+    if (!std::in_range<int64_t>(value)) {
+      return false;
+    }
+    return handler.Integer(static_cast<int64_t>(value));
+  } else if constexpr (std::same_as<T, std::string>) {
+    return handler.String(value);
+  } else if constexpr (IsVector<T>::value) {
+    if (!handler.StartList()) {
+      return false;
+    }
+    if constexpr (std::same_as<typename T::value_type, int64_t> &&
+                  required::handler::HasIntegers<Handler>) {
+      if (!value.empty() &&
+          !handler.Integers(std::span<const int64_t>(value))) {
+        return false;
+      }
+    } else {
+      for (const auto &element : value) {
+        if (!Write(element, handler)) {
+          return false;
+        }
+      }
+    }
+    return handler.EndList();
+  } else if constexpr (IsOptional<T>::value) {
+    // members that are empty are left out by their struct
+    BENCODE_ASSERT(value.has_value() && "empty optional outside a struct");
+    return Write(*value, handler);
+  } else if constexpr (required::binding::HasFieldMap<T>) {
+    return StructBinding<T>::WriteDict(value, handler);
+  } else {
+    static_assert(!sizeof(T), "no bencode binding for this type");
+  }
+}
+
+} // namespace internal::binding
+
+/**
+ * @brief a handler that fills a bound struct straight from Reader events
+ *
+ * Keys are matched through the perfect hash of their FieldMap, strings are
+ * appended chunk by chunk into their member, and values under unknown keys
+ * are skipped by counting their nesting, without storing anything.
+ */
+class BindingHandler : NonCopyable {
+  using Frame = internal::binding::Frame;
+  using Slot = internal::binding::Slot;
+
+  std::vector<Frame> frames_;
+  Slot root_;
+  Slot pending_;
+  std::string *string_ = nullptr;
+  // nesting of the unknown list or dict being skipped
+  std::size_t skip_ = 0;
+  error::ParseError error_ = error::OK;
+
+public:
+  template <typename T>
+  explicit BindingHandler(T &out) : root_(internal::binding::MakeSlot(out)) {}
+
+  // why the handler stopped the parse, OK when it did not
+  [[nodiscard]] error::ParseError error() const { return error_; }
+
+  bool Null() { return true; }
+
+  bool Integer(const int64_t i64) {
+    if (skip_ > 0) {
+      return true;
+    }
+    const Slot slot = Next();
+    if (slot.ops_ == nullptr) {
+      return true;
+    }
+    if (slot.ops_->integer_ == nullptr) {
+      return Fail(error::TYPE_MISMATCH);
+    }
+    return slot.ops_->integer_(slot.target_, i64) ||
+           Fail(error::NUMBER_TOO_BIG);
+  }
+
+  bool String(const std::string_view str) {
+    if (!StringStart(str.size())) {
+      return false;
+    }
+    return StringChunk(str) && StringEnd();
+  }
+
+  bool StringStart(const std::size_t length) {
+    string_ = nullptr;
+    if (skip_ > 0) {
+      return true;
+    }
+    const Slot slot = Next();
+    if (slot.ops_ == nullptr) {
+      return true;
+    }
+    if (slot.ops_->string_ == nullptr) {
+      return Fail(error::TYPE_MISMATCH);
+    }
+    string_ = slot.ops_->string_(slot.target_);
+    string_->clear();
+    string_->reserve(length);
+    return true;
+  }
+
+  bool StringChunk(const std::string_view chunk) {
+    if (string_ != nullptr) {
+      string_->append(chunk);
+    }
+    return true;
+  }
+
+  bool StringEnd() {
+    string_ = nullptr;
+    return true;
+  }
+
+  bool Key(const std::string_view str) {
+    if (skip_ == 0) {
+      pending_ = frames_.back().child_(frames_.back().object_, str);
+    }
+    return true;
+  }
+
+  bool StartList() { return Start(false); }
+  bool EndList() { return End(); }
+  bool StartDict() { return Start(true); }
+  bool EndDict() { return End(); }
+
+private:
+  Slot Next() {
+    if (frames_.empty()) {
+      return root_;
+    }
+    const Frame &frame = frames_.back();
+    return frame.is_dict_ ? pending_ : frame.child_(frame.object_, {});
+  }
+
+  bool Start(const bool is_dict) {
+    if (skip_ > 0) {
+      ++skip_;
+      return true;
+    }
+    const Slot slot = Next();
+    if (slot.ops_ == nullptr) {
+      skip_ = 1;
+      return true;
+    }
+    const auto open = is_dict ? slot.ops_->dict_ : slot.ops_->list_;
+    if (open == nullptr) {
+      return Fail(error::TYPE_MISMATCH);
+    }
+    frames_.push_back(open(slot.target_));
+    return true;
+  }
+
+  bool End() {
+    if (skip_ > 0) {
+      --skip_;
+    } else {
+      frames_.pop_back();
+    }
+    return true;
+  }
+
+  bool Fail(const error::ParseError err) {
+    error_ = err;
+    return false;
+  }
+};
+
+/**
+ * @brief parses bencode straight into a struct with a FieldMap, or into any
+ * other bindable type, without building a Document
+ */
+template <typename T,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+error::ParseError ParseStreamInto(ReadStream &rs, T &out) {
+  BindingHandler handler(out);
+  const auto err = Reader::Parse(rs, handler);
+  return err == error::USER_STOPPED && handler.error() != error::OK
+             ? handler.error()
+             : err;
+}
+
+template <typename T>
+error::ParseError ParseInto(const std::string_view bencode, T &out) {
+  StringReadStream rs(bencode);
+  return ParseStreamInto(rs, out);
+}
+
+/**
+ * @brief writes a bound value to handler without building a Value, the keys
+ * of each struct come out in the byte order sorted at compile time, strings
+ * are passed as views of their members and empty optionals are left out;
+ * returns false when an integer does not fit in int64_t
+ */
+template <typename T, required::handler::HasAllRequiredFunctions Handler>
+bool WriteTo(const T &value, Handler &handler) {
+  return internal::binding::Write(value, handler);
+}
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_BINDING_H_
@@ -0,0 +1,84 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_CANONICAL_H_
+#define BENCODE_INCLUDE_BENCODE_CANONICAL_H_
+
+#include <cstdint>
+
+#include <string_view>
+
+#include "exception.h"
+#include "non_copyable.h"
+#include "reader.h"
+#include "string_read_stream.h"
+
+namespace bencode {
+
+/**
+ * @brief a handler that accepts every event and keeps nothing, strings are
+ * taken in chunks so they are never copied out of the stream
+ */
+class NullHandler : NonCopyable {
+public:
+  bool Null() { return true; }
+  bool Integer(int64_t) { return true; }
+  bool String(std::string_view) { return true; }
+  bool Key(std::string_view) { return true; }
+  bool StartList() { return true; }
+  bool EndList() { return true; }
+  bool StartDict() { return true; }
+  bool EndDict() { return true; }
+
+  bool StringStart(std::size_t) { return true; }
+  bool StringChunk(std::string_view) { return true; }
+  bool StringEnd() { return true; }
+};
+
+/**
+ * @brief checks in a single pass that rs holds canonical bencode, the only
+ * encoding Writer produces for its value
+ *
+ * Integers without '+', leading zeros or -0, string lengths without leading
+ * zeros, and the keys of every dict in strictly ascending byte order. Each key
+ * is compared with the one before it in the same dict as it is read, nothing
+ * is built or re-encoded, and nesting is tracked on the heap so hostile depth
+ * cannot overflow the stack. Anything else fails with the matching ParseError.
+ */
+template <required::read_stream::HasAllRequiredFunctions ReadStream>
+error::ParseError VerifyCanonical(ReadStream &rs,
+                                  const ParseLimits &limits = ParseLimits{}) {
+  NullHandler handler;
+  return Reader::Parse<kParseCanonicalFlags | kParseNoCopyFlag |
+                       kParseIterativeFlag>(rs, handler, limits);
+}
+
+inline error::ParseError
+VerifyCanonical(const std::string_view bencode,
+                const ParseLimits &limits = ParseLimits{}) {
+  StringReadStream rs(bencode);
+  return VerifyCanonical(rs, limits);
+}
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_CANONICAL_H_
@@ -35,6 +35,8 @@
 
 #include "bencode.h"
 #include "exception.h"
+#include "key_table.h"
+#include "parse_stats.h"
 #include "reader.h"
 #include "string_read_stream.h"
 #include "value.h"
@@ -59,15 +61,47 @@ class Document : public Value {
 
   std::vector<Level> stack_;
   Value key_;
+  KeyTable *keys_ = nullptr;
   bool see_value_ = false;
+  bool pack_lists_ = false;
 
 public:
+  Document() = default;
+  // dict keys are interned in keys, which has to outlive the document's parses
+  explicit Document(KeyTable &keys) : keys_(&keys) {}
+
   error::ParseError Parse(const char *bencode, std::size_t len);
+
+  template <unsigned parseFlags = kParseDefaultFlags>
   error::ParseError Parse(std::string_view bencode);
 
-  template <required::read_stream::HasAllRequiredFunctions ReadStream>
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
   error::ParseError ParseStream(ReadStream &rs);
 
+  // same as above, also records the shape of the document and the time spent
+  // in the tokenizer and in the DOM builder into stats
+  template <unsigned parseFlags = kParseDefaultFlags>
+  error::ParseError Parse(std::string_view bencode, ParseStats &stats,
+                          const ParseLimits &limits = {});
+
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
+  error::ParseError ParseStream(ReadStream &rs, ParseStats &stats,
+                                const ParseLimits &limits = {});
+
+  // same as above, fails once the input goes past one of the limits, use this
+  // for anything that comes from an untrusted peer
+  template <unsigned parseFlags = kParseDefaultFlags>
+  error::ParseError Parse(std::string_view bencode, const ParseLimits &limits);
+
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
+  error::ParseError ParseStream(ReadStream &rs, const ParseLimits &limits);
+
+  // the tree plus the buffer the parser keeps for its stack
+  [[nodiscard]] MemoryFootprint MemoryUsage() const;
+
   // handler
   bool Null();
   bool Integer(int64_t i64);
@@ -80,6 +114,7 @@ public:
 
 private:
   Value *AddValue(Value &&value);
+  PackedList *OpenPacked(Type type);
 };
 
 inline Value *Document::Level::last_value() const {
@@ -95,14 +130,57 @@ inline error::ParseError Document::Parse(const char *bencode,
   return Parse(std::string_view(bencode, len));
 }
 
-inline error::ParseError Document::Parse(const std::string_view bencode) {
+template <unsigned parseFlags>
+error::ParseError Document::Parse(const std::string_view bencode) {
   StringReadStream rs(bencode);
-  return ParseStream(rs);
+  return ParseStream<parseFlags>(rs);
 }
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream>
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
 error::ParseError Document::ParseStream(ReadStream &rs) {
-  return Reader::Parse(rs, *this);
+  pack_lists_ = (parseFlags & kParsePackListsFlag) != 0;
+  return Reader::Parse<parseFlags>(rs, *this);
+}
+
+template <unsigned parseFlags>
+error::ParseError Document::Parse(const std::string_view bencode,
+                                  ParseStats &stats,
+                                  const ParseLimits &limits) {
+  StringReadStream rs(bencode);
+  return ParseStream<parseFlags>(rs, stats, limits);
+}
+
+template <unsigned parseFlags>
+error::ParseError Document::Parse(const std::string_view bencode,
+                                  const ParseLimits &limits) {
+  StringReadStream rs(bencode);
+  return ParseStream<parseFlags>(rs, limits);
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+error::ParseError Document::ParseStream(ReadStream &rs,
+                                        const ParseLimits &limits) {
+  pack_lists_ = (parseFlags & kParsePackListsFlag) != 0;
+  return Reader::Parse<parseFlags>(rs, *this, limits);
+}
+
+inline MemoryFootprint Document::MemoryUsage() const {
+  auto usage = Value::MemoryUsage();
+  usage.slack_bytes_ += stack_.capacity() * sizeof(Level);
+  return usage;
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+error::ParseError Document::ParseStream(ReadStream &rs, ParseStats &stats,
+                                        const ParseLimits &limits) {
+  pack_lists_ = (parseFlags & kParsePackListsFlag) != 0;
+  StatsHandler handler(*this, stats);
+  return handler.Run([&rs, &limits](auto &stats_handler) {
+    return Reader::Parse<parseFlags>(rs, stats_handler, limits);
+  });
 }
 
 inline bool Document::Null() {
@@ -111,17 +189,30 @@ inline bool Document::Null() {
 }
 
 inline bool Document::Integer(const int64_t i64) {
-  AddValue(Value(i64));
+  if (auto *packed = OpenPacked(B_INTEGER); packed != nullptr) {
+    packed->integers_.push_back(i64);
+  } else {
+    AddValue(Value(i64));
+  }
   return true;
 }
 
 inline bool Document::String(const std::string_view str) {
-  AddValue(Value(str));
+  if (auto *packed = OpenPacked(B_STRING); packed != nullptr) {
+    packed->bytes_.append(str);
+    packed->ends_.push_back(packed->bytes_.size());
+  } else {
+    AddValue(Value(str));
+  }
   return true;
 }
 
 inline bool Document::Key(const std::string_view str) {
-  AddValue(Value(str));
+  if (keys_ != nullptr) {
+    AddValue(Value(keys_->Intern(str)));
+  } else {
+    AddValue(Value(str));
+  }
   return true;
 }
 
@@ -149,6 +240,23 @@ inline bool Document::EndDict() {
   return true;
 }
 
+// the packed elements of the innermost list if an element of type may be
+// added to them, the first one packs an empty list
+inline PackedList *Document::OpenPacked(const Type type) {
+  if (!pack_lists_ || stack_.empty() || stack_.back().type() != B_LIST) {
+    return nullptr;
+  }
+  auto &top = stack_.back();
+  if (top.value_count_ == 0) {
+    top.value_->data_ = std::make_shared<PackedList>(type);
+  }
+  if (!top.value_->IsPacked() || top.value_->GetPackedType() != type) {
+    return nullptr;
+  }
+  ++top.value_count_;
+  return std::get<std::shared_ptr<PackedList>>(top.value_->data_).get();
+}
+
 inline Value *Document::AddValue(Value &&value) {
   const auto type = value.GetType();
   (void)type;
@@ -48,6 +48,19 @@ namespace bencode {
   ERROR_FIELD(MISS_KEY, "miss key")                                            \
   ERROR_FIELD(MISS_COLON, "miss colon")                                        \
   ERROR_FIELD(USER_STOPPED, "user stopped Parse")                              \
+  ERROR_FIELD(MISS_STRING_DATA, "miss string data")                            \
+  ERROR_FIELD(DEPTH_LIMIT_EXCEEDED, "depth limit exceeded")                    \
+  ERROR_FIELD(STRING_TOO_LONG, "string too long")                              \
+  ERROR_FIELD(TOO_MANY_ELEMENTS, "too many elements")                          \
+  ERROR_FIELD(TOTAL_BYTES_EXCEEDED, "total bytes exceeded")                    \
+  ERROR_FIELD(LEADING_PLUS, "leading plus")                                    \
+  ERROR_FIELD(NEGATIVE_ZERO, "negative zero")                                  \
+  ERROR_FIELD(LEADING_ZERO, "leading zero")                                    \
+  ERROR_FIELD(UNSORTED_KEYS, "unsorted keys")                                  \
+  ERROR_FIELD(DUPLICATE_KEY, "duplicate key")                                  \
+  ERROR_FIELD(TYPE_MISMATCH, "type mismatch")                                  \
+  ERROR_FIELD(MISS_MEMBER, "miss member")                                      \
+  ERROR_FIELD(BAD_PIECES, "bad pieces")                                        \
   //
 
 namespace error {
@@ -0,0 +1,262 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_FD_WRITE_STREAM_H_
+#define BENCODE_INCLUDE_BENCODE_FD_WRITE_STREAM_H_
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <limits>
+#include <new>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bencode.h"
+#include "non_copyable.h"
+
+namespace bencode {
+
+/**
+ * @brief write stream over a POSIX file descriptor
+ *
+ * Bytes are collected in a large aligned buffer and written with write(2),
+ * retrying on EINTR and partial writes, so nothing is buffered twice as with
+ * stdio. Like FileWriteStream, flush() writes every pending byte, so once a
+ * Writer ends a top-level value it is on the descriptor.
+ *
+ * In direct mode the descriptor is switched to O_DIRECT (F_NOCACHE on macOS)
+ * and only whole aligned blocks are written while the buffer fills up. flush()
+ * writes the unaligned tail with direct I/O turned off, which leaves the file
+ * offset unaligned, so direct I/O stays off from there on; it pays off for a
+ * single large value. Direct I/O is only enabled when the file offset is block
+ * aligned, and a write refused with EINVAL turns it off and is retried, so a
+ * file system without direct I/O support keeps the stream buffered.
+ *
+ * The owned buffer is allocated with aligned_alloc, std::bad_alloc is thrown
+ * if that fails.
+ *
+ * The first failed write(2) is kept in error(), later output is dropped.
+ */
+class FdWriteStream : NonCopyable {
+public:
+  static constexpr std::size_t kAlignment = 4096;
+  static constexpr std::size_t kDefaultBufferSize = 4 << 20;
+
+private:
+  int fd_;
+  char *buffer_;
+  char *buffer_end_;
+  char *current_;
+  bool owned_;
+  bool direct_;
+  int error_;
+
+public:
+  explicit FdWriteStream(const int fd,
+                         const std::size_t buffer_size = kDefaultBufferSize,
+                         const bool direct = false)
+      : fd_(fd), buffer_(Allocate(buffer_size)),
+        buffer_end_(buffer_ + BlockSize(buffer_size)), current_(buffer_),
+        owned_(true), direct_(false), error_(0) {
+    BENCODE_ASSERT(fd_ >= 0 && "file descriptor should not be negative");
+    if (direct && Aligned()) {
+      direct_ = SetDirect(true);
+    }
+  }
+
+  FdWriteStream(const int fd, char *buffer, const std::size_t buffer_size,
+                const bool direct = false)
+      : fd_(fd), buffer_(buffer), buffer_end_(buffer + buffer_size),
+        current_(buffer_), owned_(false), direct_(false), error_(0) {
+    BENCODE_ASSERT(fd_ >= 0 && "file descriptor should not be negative");
+    BENCODE_ASSERT(buffer_size > 0 && "buffer size should not be zero");
+    // O_DIRECT needs an aligned buffer of whole blocks
+    if (direct && reinterpret_cast<std::uintptr_t>(buffer) % kAlignment == 0 &&
+        buffer_size % kAlignment == 0 && Aligned()) {
+      direct_ = SetDirect(true);
+    }
+  }
+
+  ~FdWriteStream() {
+    finish();
+    if (owned_) {
+      std::free(buffer_);
+    }
+  }
+
+  [[nodiscard]] bool direct() const { return direct_; }
+  [[nodiscard]] int error() const { return error_; }
+
+  void put(const char ch) {
+    if (current_ >= buffer_end_) {
+      Drain();
+    }
+    *current_++ = ch;
+  }
+
+  void put_n(const char ch, std::size_t size) {
+    auto avail = static_cast<std::size_t>(buffer_end_ - current_);
+    while (size > avail) {
+      std::memset(current_, ch, avail);
+      current_ += avail;
+      Drain();
+      size -= avail;
+      avail = static_cast<std::size_t>(buffer_end_ - current_);
+    }
+    if (size > 0) {
+      std::memset(current_, ch, size);
+      current_ += size;
+    }
+  }
+
+  void puts(const char *str, std::size_t length) {
+    auto avail = static_cast<std::size_t>(buffer_end_ - current_);
+    if (length <= avail) {
+      std::memcpy(current_, str, length);
+      current_ += length;
+      return;
+    }
+
+    // a buffered stream writes large payloads straight from the caller
+    if (!direct_ && length >= static_cast<std::size_t>(buffer_end_ - buffer_)) {
+      Drain();
+      Write(str, length);
+      return;
+    }
+
+    while (length > avail) {
+      std::memcpy(current_, str, avail);
+      current_ += avail;
+      str += avail;
+      length -= avail;
+      Drain();
+      avail = static_cast<std::size_t>(buffer_end_ - current_);
+    }
+    std::memcpy(current_, str, length);
+    current_ += length;
+  }
+
+  void put_sv(const std::string_view sv) { puts(sv.data(), sv.size()); }
+
+  /**
+   * @brief writes every pending byte, turning direct I/O off for the tail
+   */
+  void flush() {
+    Drain();
+    if (current_ != buffer_) {
+      if (direct_) {
+        direct_ = !SetDirect(false);
+      }
+      Write(buffer_, static_cast<std::size_t>(current_ - buffer_));
+      current_ = buffer_;
+    }
+  }
+
+  void finish() { flush(); }
+
+private:
+  void Drain() {
+    auto size = static_cast<std::size_t>(current_ - buffer_);
+    if (direct_) {
+      // keep the unaligned tail for the next block or finish()
+      size -= size % kAlignment;
+    }
+    if (size == 0) {
+      return;
+    }
+    Write(buffer_, size);
+    const auto tail = static_cast<std::size_t>(current_ - buffer_) - size;
+    std::memmove(buffer_, buffer_ + size, tail);
+    current_ = buffer_ + tail;
+  }
+
+  // whole blocks, at least one
+  static std::size_t BlockSize(const std::size_t size) {
+    return size == 0 ? kAlignment
+                     : (size - 1) / kAlignment * kAlignment + kAlignment;
+  }
+
+  static char *Allocate(const std::size_t size) {
+    if (size > std::numeric_limits<std::size_t>::max() - kAlignment) {
+      throw std::bad_alloc();
+    }
+    auto *buffer =
+        static_cast<char *>(std::aligned_alloc(kAlignment, BlockSize(size)));
+    if (buffer == nullptr) {
+      throw std::bad_alloc();
+    }
+    return buffer;
+  }
+
+  // O_DIRECT also needs the file offset on a block boundary
+  [[nodiscard]] bool Aligned() const {
+    const auto offset = ::lseek(fd_, 0, SEEK_CUR);
+    return offset >= 0 &&
+           static_cast<std::uint64_t>(offset) % kAlignment == 0;
+  }
+
+  bool SetDirect(const bool on) const {
+#if defined(O_DIRECT)
+    const int flags = ::fcntl(fd_, F_GETFL);
+    if (flags == -1) {
+      return false;
+    }
+    return ::fcntl(fd_, F_SETFL, on ? flags | O_DIRECT : flags & ~O_DIRECT) !=
+           -1;
+#elif defined(F_NOCACHE)
+    return ::fcntl(fd_, F_NOCACHE, on ? 1 : 0) != -1;
+#else
+    (void)on;
+    return false;
+#endif
+  }
+
+  void Write(const char *data, std::size_t size) {
+    while (size > 0 && error_ == 0) {
+      const auto ret = ::write(fd_, data, size);
+      if (ret < 0) {
+        if (errno == EINVAL && direct_ && SetDirect(false)) {
+          // the file system refused direct I/O, retry buffered
+          direct_ = false;
+        } else if (errno != EINTR) {
+          error_ = errno;
+        }
+        continue;
+      }
+      if (ret == 0) {
+        error_ = EIO;
+        break;
+      }
+      data += ret;
+      size -= static_cast<std::size_t>(ret);
+    }
+  }
+};
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_FD_WRITE_STREAM_H_
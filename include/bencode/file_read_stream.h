@@ -29,6 +29,10 @@
 
 #include <cstdio>
 
+#include <algorithm>
+#include <string>
+#include <string_view>
+
 #include "bencode.h"
 #include "non_copyable.h"
 
@@ -40,6 +44,7 @@ class FileReadStream : NonCopyable {
   char inner_buffer_[kInnerBufferSize]{};
   char *buffer_;
   char *current_;
+  char last_char_;
   char *buffer_last_;
   std::size_t buffer_size_;
   std::size_t read_count_;
@@ -49,7 +54,8 @@ class FileReadStream : NonCopyable {
 public:
   explicit FileReadStream(std::FILE *fp)
       : fp_(fp), buffer_(inner_buffer_), current_(inner_buffer_),
-        buffer_last_(nullptr), buffer_size_(kInnerBufferSize), read_count_(0),
+        last_char_('\0'), buffer_last_(nullptr),
+        buffer_size_(kInnerBufferSize), read_count_(0),
         read_total_(0), eof_(false) {
     BENCODE_ASSERT(fp_ != nullptr && "file pointer should not be empty");
     read();
@@ -57,8 +63,9 @@ public:
 
   explicit FileReadStream(std::FILE *fp, char *buffer,
                           const std::size_t buffer_size)
-      : fp_(fp), buffer_(buffer), current_(buffer), buffer_last_(nullptr),
-        buffer_size_(buffer_size), read_count_(0), read_total_(0), eof_(false) {
+      : fp_(fp), buffer_(buffer), current_(buffer), last_char_('\0'),
+        buffer_last_(nullptr), buffer_size_(buffer_size), read_count_(0),
+        read_total_(0), eof_(false) {
     BENCODE_ASSERT(fp_ != nullptr && "file pointer should not be empty");
     BENCODE_ASSERT(buffer_size_ >= 4 &&
                    "buffer size should be bigger then four");
@@ -67,8 +74,9 @@ public:
 
   template <std::size_t N>
   explicit FileReadStream(std::FILE *fp, char (&buffer)[N])
-      : fp_(fp), buffer_(buffer), current_(buffer), buffer_last_(nullptr),
-        buffer_size_(N), read_count_(0), read_total_(0), eof_(false) {
+      : fp_(fp), buffer_(buffer), current_(buffer), last_char_('\0'),
+        buffer_last_(nullptr), buffer_size_(N), read_count_(0),
+        read_total_(0), eof_(false) {
     BENCODE_ASSERT(fp_ != nullptr && "file pointer should not be empty");
     BENCODE_ASSERT(buffer_size_ >= 4 &&
                    "buffer size should be bigger then four");
@@ -81,16 +89,53 @@ public:
 
   [[nodiscard]] char peek() const { return *current_; }
 
+  // bytes consumed so far, after a parse with kParseStopWhenDoneFlag this is
+  // the length of the root value
+  [[nodiscard]] std::size_t tell() const {
+    return read_total_ + static_cast<std::size_t>(current_ - buffer_);
+  }
+
   char next() {
     const char ch = *current_;
     read();
     return ch;
   }
 
-  std::string next(const std::size_t n) {
-    auto str = std::make_shared<std::string>();
-    auto ret = read(str, n);
-    return {ret->c_str(), ret->size()};
+  std::string next(std::size_t n) {
+    std::string str;
+    str.reserve(n);
+    while (n > 0 && hasNext()) {
+      // once eof is hit buffer_last_ points at the terminating zero
+      const auto avail =
+          static_cast<std::size_t>(buffer_last_ - current_) + !eof_;
+      const std::size_t count = std::min(n, avail);
+      str.append(current_, count);
+      n -= count;
+      current_ += count - 1;
+      read();
+    }
+    return str;
+  }
+
+  /**
+   * @brief returns up to n bytes straight from the buffer without copying,
+   * the view is valid until the next call on the stream
+   */
+  std::string_view nextChunk(const std::size_t n) {
+    if (n == 0 || !hasNext()) {
+      return {};
+    }
+    // the buffer is refilled once its last byte is consumed, leave that byte
+    // for a call of its own and hand it out from a copy
+    const auto avail = static_cast<std::size_t>(buffer_last_ - current_);
+    if (avail > 0) {
+      const std::size_t count = std::min(n, avail);
+      const char *start = current_;
+      current_ += count;
+      return {start, count};
+    }
+    last_char_ = next();
+    return {&last_char_, 1};
   }
 
   void skip(const std::size_t n) {
@@ -126,39 +171,6 @@ private:
       }
     }
   }
-
-  std::shared_ptr<std::string> &read(std::shared_ptr<std::string> &str,
-                                     const std::size_t n = 1) {
-    if (current_ + n <= buffer_last_) {
-      str->append(current_, n);
-      current_ += n;
-      return str;
-    } else if (!eof_) {
-      const std::size_t remaining = n - (buffer_last_ - current_ + 1);
-      const std::size_t need_read = n - remaining;
-      str->append(current_, buffer_last_ - current_ + 1);
-
-      read_total_ += read_count_;
-      read_count_ = std::fread(buffer_, 1, buffer_size_, fp_);
-      buffer_last_ = buffer_ + read_count_ - 1;
-      current_ = buffer_;
-
-      if (read_count_ < buffer_size_) {
-        buffer_[read_count_] = '\0';
-        ++buffer_last_;
-        eof_ = true;
-      }
-
-      if (eof_ && need_read > read_count_) {
-        str->append(current_, read_count_);
-        return str;
-      }
-
-      return read(str, need_read);
-    }
-
-    return str;
-  }
 };
 
 } // namespace bencode
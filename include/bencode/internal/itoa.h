@@ -27,10 +27,30 @@
 #ifndef BENCODE_INCLUDE_BENCODE_INTERNAL_ITOA_H_
 #define BENCODE_INCLUDE_BENCODE_INTERNAL_ITOA_H_
 
+#include <cstdint>
+
+#include <span>
+#include <type_traits>
+
 #include "bencode/bencode.h"
 
+#if defined(BENCODE_SSE2)
+#include <emmintrin.h>
+#endif
+
 namespace bencode::internal {
 
+/**
+ * @brief longest integer in i...e form: "i-9223372036854775808e"
+ */
+constexpr std::size_t kMaxEncodedIntegerSize = 22;
+
+/**
+ * @brief bytes u64toa and i64toa may store from buffer on, the SSE2 path writes
+ * whole blocks so this holds even for short values
+ */
+constexpr std::size_t kItoaBufferSize = 21;
+
 constexpr char kDigitsLut[200] = {
     '0', '0', '0', '1', '0', '2', '0', '3', '0', '4', '0', '5', '0', '6', '0',
     '7', '0', '8', '0', '9', '1', '0', '1', '1', '1', '2', '1', '3', '1', '4',
@@ -47,7 +67,7 @@ constexpr char kDigitsLut[200] = {
     '9', '0', '9', '1', '9', '2', '9', '3', '9', '4', '9', '5', '9', '6', '9',
     '7', '9', '8', '9', '9'};
 
-inline char *u32toa(uint32_t value, char *buffer) {
+constexpr char *u32toa(uint32_t value, char *buffer) {
   BENCODE_ASSERT(buffer != nullptr);
 
   if (value < 10000) {
@@ -116,7 +136,7 @@ inline char *u32toa(uint32_t value, char *buffer) {
   return buffer;
 }
 
-inline char *i32toa(const int32_t value, char *buffer) {
+constexpr char *i32toa(const int32_t value, char *buffer) {
   BENCODE_ASSERT(buffer != nullptr);
   auto u = static_cast<uint32_t>(value);
   if (value < 0) {
@@ -127,7 +147,7 @@ inline char *i32toa(const int32_t value, char *buffer) {
   return u32toa(u, buffer);
 }
 
-inline char *u64toa(uint64_t value, char *buffer) {
+constexpr char *u64toa_lut(uint64_t value, char *buffer) {
   BENCODE_ASSERT(buffer != nullptr);
   constexpr uint64_t kTen8 = 100000000;
   constexpr uint64_t kTen9 = kTen8 * 10;
@@ -301,7 +321,173 @@ inline char *u64toa(uint64_t value, char *buffer) {
   return buffer;
 }
 
-inline char *i64toa(const int64_t value, char *buffer) {
+#if defined(BENCODE_SSE2)
+
+alignas(16) constexpr uint32_t kDiv10000Vector[4] = {0xd1b71759, 0xd1b71759,
+                                                     0xd1b71759, 0xd1b71759};
+alignas(16) constexpr uint32_t k10000Vector[4] = {10000, 10000, 10000, 10000};
+alignas(16) constexpr uint16_t kDivPowersVector[8] = {
+    8389, 5243, 13108, 32768, 8389, 5243, 13108, 32768}; // 10^3 .. 10^0
+alignas(16) constexpr uint16_t kShiftPowersVector[8] = {
+    1 << (16 - (23 + 2 - 16)), 1 << (16 - (19 + 2 - 16)), 1 << (16 - 1 - 2),
+    1 << 15,
+    1 << (16 - (23 + 2 - 16)), 1 << (16 - (19 + 2 - 16)), 1 << (16 - 1 - 2),
+    1 << 15};
+alignas(16) constexpr uint16_t k10Vector[8] = {10, 10, 10, 10,
+                                               10, 10, 10, 10};
+alignas(16) constexpr char kAsciiZero[16] = {'0', '0', '0', '0', '0', '0',
+                                             '0', '0', '0', '0', '0', '0',
+                                             '0', '0', '0', '0'};
+
+inline __m128i Load(const void *p) {
+  return _mm_load_si128(static_cast<const __m128i *>(p));
+}
+
+/**
+ * @brief splits abcdefgh (< 10^8) into eight 16-bit lanes [a..h]
+ */
+inline __m128i Convert8DigitsSSE2(const uint32_t value) {
+  BENCODE_ASSERT(value <= 99999999);
+
+  // abcd, efgh = abcdefgh divmod 10000
+  const __m128i abcdefgh = _mm_cvtsi32_si128(static_cast<int>(value));
+  const __m128i abcd =
+      _mm_srli_epi64(_mm_mul_epu32(abcdefgh, Load(kDiv10000Vector)), 45);
+  const __m128i efgh =
+      _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, Load(k10000Vector)));
+
+  // v1 = [abcd, efgh, 0, 0, 0, 0, 0, 0], v1a = v1 * 4
+  const __m128i v1 = _mm_unpacklo_epi16(abcd, efgh);
+  const __m128i v1a = _mm_slli_epi64(v1, 2);
+
+  // v2 = [abcd * 4 (x4), efgh * 4 (x4)]
+  const __m128i v2a = _mm_unpacklo_epi16(v1a, v1a);
+  const __m128i v2 = _mm_unpacklo_epi32(v2a, v2a);
+
+  // v4 = v2 div 10^3, 10^2, 10^1, 10^0 = [a, ab, abc, abcd, e, ef, efg, efgh]
+  const __m128i v3 = _mm_mulhi_epu16(v2, Load(kDivPowersVector));
+  const __m128i v4 = _mm_mulhi_epu16(v3, Load(kShiftPowersVector));
+
+  // v6 = (v4 * 10) << 16 = [0, a0, ab0, abc0, 0, e0, ef0, efg0]
+  const __m128i v5 = _mm_mullo_epi16(v4, Load(k10Vector));
+  const __m128i v6 = _mm_slli_epi64(v5, 16);
+
+  // v7 = v4 - v6 = [a, b, c, d, e, f, g, h]
+  return _mm_sub_epi16(v4, v6);
+}
+
+inline __m128i ShiftDigitsSSE2(const __m128i a, const unsigned digit) {
+  BENCODE_ASSERT(digit <= 8);
+  switch (digit) {
+  case 1:
+    return _mm_srli_si128(a, 1);
+  case 2:
+    return _mm_srli_si128(a, 2);
+  case 3:
+    return _mm_srli_si128(a, 3);
+  case 4:
+    return _mm_srli_si128(a, 4);
+  case 5:
+    return _mm_srli_si128(a, 5);
+  case 6:
+    return _mm_srli_si128(a, 6);
+  case 7:
+    return _mm_srli_si128(a, 7);
+  case 8:
+    return _mm_srli_si128(a, 8);
+  default:
+    return a;
+  }
+}
+
+/**
+ * @brief number of leading '0' in the ascii digits, at most 15
+ */
+inline unsigned LeadingZeroDigits(const __m128i digits) {
+  const auto mask = static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(digits, Load(kAsciiZero))));
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, ~mask | 0x8000);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(~mask | 0x8000));
+#endif
+}
+
+/**
+ * @brief converts 8 digits at a time with SSE2, stores whole blocks so up to 20
+ * bytes from buffer on may be touched even for short values
+ */
+inline char *u64toa_sse2(uint64_t value, char *buffer) {
+  BENCODE_ASSERT(buffer != nullptr);
+  constexpr uint64_t kTen8 = 100000000;
+  constexpr uint64_t kTen16 = kTen8 * kTen8;
+
+  if (value < kTen8) {
+    const auto v = static_cast<uint32_t>(value);
+    if (v < 10000) {
+      return u32toa(v, buffer);
+    }
+
+    // value = bbbbcccc
+    const __m128i a = Convert8DigitsSSE2(v);
+    const __m128i va = _mm_add_epi8(_mm_packus_epi16(a, _mm_setzero_si128()),
+                                    Load(kAsciiZero));
+    const unsigned digit = LeadingZeroDigits(va);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(buffer),
+                     ShiftDigitsSSE2(va, digit));
+    return buffer + 8 - digit;
+  }
+
+  if (value < kTen16) {
+    const auto v0 = static_cast<uint32_t>(value / kTen8);
+    const auto v1 = static_cast<uint32_t>(value % kTen8);
+
+    const __m128i a0 = Convert8DigitsSSE2(v0);
+    const __m128i a1 = Convert8DigitsSSE2(v1);
+    const __m128i va =
+        _mm_add_epi8(_mm_packus_epi16(a0, a1), Load(kAsciiZero));
+    const unsigned digit = LeadingZeroDigits(va);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer),
+                     ShiftDigitsSSE2(va, digit));
+    return buffer + 16 - digit;
+  }
+
+  // value = aaaa bbbbbbbb cccccccc, a from 1 to 1844
+  buffer = u32toa(static_cast<uint32_t>(value / kTen16), buffer);
+  value %= kTen16;
+
+  const __m128i a0 = Convert8DigitsSSE2(static_cast<uint32_t>(value / kTen8));
+  const __m128i a1 = Convert8DigitsSSE2(static_cast<uint32_t>(value % kTen8));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(buffer),
+                   _mm_add_epi8(_mm_packus_epi16(a0, a1), Load(kAsciiZero)));
+  return buffer + 16;
+}
+
+#endif // BENCODE_SSE2
+
+/**
+ * @brief writes the digits of value and returns their end, buffer needs
+ * kItoaBufferSize bytes whatever the value
+ */
+constexpr char *u64toa(const uint64_t value, char *buffer) {
+#if defined(BENCODE_SSE2)
+  // intrinsics are not usable in constant evaluation
+  if (std::is_constant_evaluated()) {
+    return u64toa_lut(value, buffer);
+  }
+  return u64toa_sse2(value, buffer);
+#else
+  return u64toa_lut(value, buffer);
+#endif
+}
+
+/**
+ * @brief writes value with a leading '-' if negative and returns its end,
+ * buffer needs kItoaBufferSize bytes whatever the value
+ */
+constexpr char *i64toa(const int64_t value, char *buffer) {
   BENCODE_ASSERT(buffer != nullptr);
   auto u = static_cast<uint64_t>(value);
   if (value < 0) {
@@ -312,6 +498,21 @@ inline char *i64toa(const int64_t value, char *buffer) {
   return u64toa(u, buffer);
 }
 
+/**
+ * @brief encodes every value in i...e form back to back, buffer needs
+ * kMaxEncodedIntegerSize bytes per value whatever the values
+ */
+constexpr char *i64toa_list(const std::span<const int64_t> values,
+                            char *buffer) {
+  BENCODE_ASSERT(buffer != nullptr);
+  for (const int64_t value : values) {
+    *buffer++ = 'i';
+    buffer = i64toa(value, buffer);
+    *buffer++ = 'e';
+  }
+  return buffer;
+}
+
 } // namespace bencode::internal
 
 #endif // BENCODE_INCLUDE_BENCODE_INTERNAL_ITOA_H_
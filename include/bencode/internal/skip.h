@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_INTERNAL_SKIP_H_
+#define BENCODE_INCLUDE_BENCODE_INTERNAL_SKIP_H_
+
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+
+#include "bencode/bencode.h"
+#include "bencode/exception.h"
+#include "bencode/reader.h"
+#include "bencode/string_read_stream.h"
+
+namespace bencode::internal {
+
+/**
+ * @brief reads the length prefix of a string at pos, leaves pos behind the
+ * colon and returns the length, which is checked against the input size
+ */
+inline std::size_t ScanStringLength(const std::string_view bencode,
+                                    std::size_t &pos) {
+  if (pos >= bencode.size() || bencode[pos] < '0' || bencode[pos] > '9') {
+    throw Exception(error::MISS_STRING_LENGTH);
+  }
+
+  std::size_t length = 0;
+  const std::size_t start = pos;
+  for (; pos < bencode.size() && bencode[pos] >= '0' && bencode[pos] <= '9';
+       ++pos) {
+    if (length > (SIZE_MAX - 9) / 10) {
+      throw Exception(error::NUMBER_TOO_BIG);
+    }
+    length = length * 10 + static_cast<std::size_t>(bencode[pos] - '0');
+  }
+  if (bencode[start] == '0' && pos - start > 1) {
+    throw Exception(error::MISS_COLON);
+  }
+
+  if (pos >= bencode.size() || bencode[pos] != ':') {
+    throw Exception(error::MISS_COLON);
+  }
+  ++pos;
+
+  if (length > bencode.size() - pos) {
+    throw Exception(error::MISS_STRING_DATA);
+  }
+  return length;
+}
+
+/**
+ * @brief steps over the value starting at pos without building anything and
+ * returns the offset right behind it
+ *
+ * Nesting is tracked in a small explicit stack, so deep input cannot exhaust
+ * the call stack.
+ */
+inline std::size_t SkipValue(const std::string_view bencode, std::size_t pos) {
+  // one entry per open container: 'l' list, 'k' dict before a key, 'v' dict
+  // before a value
+  std::string stack;
+
+  while (true) {
+    if (pos >= bencode.size()) {
+      throw Exception(error::EXPECT_VALUE);
+    }
+
+    const char ch = bencode[pos];
+    if (!stack.empty() && ch == 'e' && stack.back() != 'v') {
+      ++pos;
+      stack.pop_back();
+    } else if (!stack.empty() && stack.back() == 'k') {
+      if (ch < '0' || ch > '9') {
+        throw Exception(error::MISS_KEY);
+      }
+      pos += ScanStringLength(bencode, pos);
+      stack.back() = 'v';
+      continue;
+    } else if (ch == 'l' || ch == 'd') {
+      ++pos;
+      if (!stack.empty() && stack.back() == 'v') {
+        stack.back() = 'k';
+      }
+      stack.push_back(ch == 'l' ? 'l' : 'k');
+      continue;
+    } else if (ch == 'i') {
+      // the same digits Reader accepts, so the members PatchDocument indexes
+      // also parse as values
+      StringReadStream rs(bencode.substr(pos + 1));
+      Reader::ScanInteger(rs);
+      pos += 1 + rs.tell();
+      if (pos >= bencode.size() || bencode[pos] != 'e') {
+        throw Exception(error::MISS_TRAILING_E);
+      }
+      ++pos;
+    } else if (ch >= '0' && ch <= '9') {
+      pos += ScanStringLength(bencode, pos);
+    } else {
+      throw Exception(error::BAD_VALUE);
+    }
+
+    if (stack.empty()) {
+      return pos;
+    }
+    if (stack.back() == 'v') {
+      stack.back() = 'k';
+    }
+  }
+}
+
+} // namespace bencode::internal
+
+#endif // BENCODE_INCLUDE_BENCODE_INTERNAL_SKIP_H_
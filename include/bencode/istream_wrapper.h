@@ -27,7 +27,12 @@
 #ifndef BENCODE_INCLUDE_BENCODE_ISTREAM_WRAPPER_H_
 #define BENCODE_INCLUDE_BENCODE_ISTREAM_WRAPPER_H_
 
-#include <sstream>
+#include <algorithm>
+#include <concepts>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <string_view>
 
 #include "bencode.h"
 #include "non_copyable.h"
@@ -38,137 +43,192 @@ namespace required {
 
 template <typename Stream>
 concept StreamCharTypeIsChar =
-    requires { std::same_as<typename Stream::char_type, char>; };
+    std::same_as<typename Stream::char_type, char> && requires(Stream &s) {
+      { s.rdbuf() } -> std::convertible_to<std::basic_streambuf<char> *>;
+    };
 
 } // namespace required
 
+/**
+ * @brief read stream over the std::basic_streambuf of any std::istream
+ *
+ * If the stream buffer already holds data in its get area, the wrapper reads
+ * straight from it, otherwise it pulls whole blocks with sgetn() into its own
+ * buffer. next(n) returns a view into the buffered bytes when the span is fully
+ * buffered, a span crossing a refill is gathered into an internal string; in
+ * both cases the view is valid until the next call on the wrapper.
+ *
+ * Bytes consumed from the get area are committed back to the stream buffer on
+ * every refill and on destruction, bytes read ahead into the own buffer are not
+ * given back.
+ */
 template <required::StreamCharTypeIsChar Stream>
 class IStreamWrapper : NonCopyable {
+  using StreamBuf = std::basic_streambuf<char, typename Stream::traits_type>;
+
+  // exposes the protected get area pointers of any stream buffer
+  struct GetArea : StreamBuf {
+    using StreamBuf::egptr;
+    using StreamBuf::gbump;
+    using StreamBuf::gptr;
+  };
+
   static constexpr std::size_t kInnerBufferSize = 256;
-  Stream &stream_;
+  static constexpr std::size_t kMaxDirectRead = 1 << 20;
+  StreamBuf *sb_;
   char inner_buffer_[kInnerBufferSize]{};
   char *buffer_;
-  char *current_;
-  char *buffer_last_;
   std::size_t buffer_size_;
-  std::size_t read_count_;
-  std::size_t read_total_;
+  const char *begin_;
+  const char *current_;
+  const char *last_;
+  bool borrowed_;
   bool eof_;
+  std::size_t fetched_;
+  std::string span_;
 
 public:
   explicit IStreamWrapper(Stream &stream)
-      : stream_(stream), buffer_(inner_buffer_), current_(inner_buffer_),
-        buffer_last_(nullptr), buffer_size_(kInnerBufferSize), read_count_(0),
-        read_total_(0), eof_(false) {
-    read();
-  }
+      : sb_(stream.rdbuf()), buffer_(inner_buffer_),
+        buffer_size_(kInnerBufferSize), begin_(nullptr), current_(nullptr),
+        last_(nullptr), borrowed_(false), eof_(sb_ == nullptr), fetched_(0),
+        span_() {}
 
   IStreamWrapper(Stream &stream, char *buffer, const std::size_t buffer_size)
-      : stream_(stream), buffer_(buffer), current_(buffer_),
-        buffer_last_(nullptr), buffer_size_(buffer_size), read_count_(0),
-        read_total_(0), eof_(false) {
+      : sb_(stream.rdbuf()), buffer_(buffer), buffer_size_(buffer_size),
+        begin_(nullptr), current_(nullptr), last_(nullptr), borrowed_(false),
+        eof_(sb_ == nullptr), fetched_(0), span_() {
     BENCODE_ASSERT(buffer_size_ >= 4 &&
                    "buffer size should be bigger then four");
-    read();
   }
 
   template <std::size_t N>
   IStreamWrapper(Stream &stream, char (&buffer)[N])
-      : stream_(stream), buffer_(buffer), current_(buffer_),
-        buffer_last_(nullptr), buffer_size_(N), read_count_(0), read_total_(0),
-        eof_(false) {
-    BENCODE_ASSERT(buffer_size_ >= 4 &&
-                   "buffer size should be bigger then four");
-    read();
-  }
+      : IStreamWrapper(stream, buffer, N) {}
 
-  [[nodiscard]] bool hasNext() const {
-    return !eof_ || (current_ + 1 - !eof_ <= buffer_last_);
-  }
+  ~IStreamWrapper() { commit(); }
 
-  [[nodiscard]] char peek() const { return *current_; }
+  [[nodiscard]] bool hasNext() { return current_ != last_ || fill(); }
 
-  char next() {
-    const char ch = *current_;
-    read();
-    return ch;
-  }
+  [[nodiscard]] char peek() { return hasNext() ? *current_ : '\0'; }
 
-  std::string next(const std::size_t n) {
-    auto str = std::make_shared<std::string>();
-    auto ret = read(str, n);
-    return {ret->c_str(), ret->size()};
+  char next() { return hasNext() ? *current_++ : '\0'; }
+
+  // bytes consumed so far, after a parse with kParseStopWhenDoneFlag this is
+  // the length of the root value
+  [[nodiscard]] std::size_t tell() const {
+    return fetched_ - static_cast<std::size_t>(last_ - current_);
   }
 
-  void skip(const std::size_t n) {
-    for (std::size_t i = 0; i < n; ++i) {
-      if (hasNext()) {
-        read();
-      } else {
+  std::string_view next(const std::size_t n) {
+    if (static_cast<std::size_t>(last_ - current_) >= n) {
+      const char *start = current_;
+      current_ += n;
+      return {start, n};
+    }
+
+    span_.assign(current_, last_);
+    current_ = last_;
+    while (span_.size() < n && fill()) {
+      const std::size_t remaining = n - span_.size();
+      const auto avail = static_cast<std::size_t>(last_ - current_);
+
+      // a large remainder behind an empty get area bypasses the own buffer
+      if (!borrowed_ && remaining > avail && avail == buffer_size_) {
+        span_.append(current_, last_);
+        current_ = last_;
+        direct(n);
         break;
       }
+
+      const std::size_t count = std::min(remaining, avail);
+      span_.append(current_, count);
+      current_ += count;
+    }
+    return span_;
+  }
+
+  std::string_view nextChunk(const std::size_t n) {
+    if (!hasNext()) {
+      return {};
+    }
+    const char *start = current_;
+    current_ += std::min(n, static_cast<std::size_t>(last_ - current_));
+    return {start, current_};
+  }
+
+  void skip(std::size_t n) {
+    while (n > 0 && hasNext()) {
+      const std::size_t count =
+          std::min(n, static_cast<std::size_t>(last_ - current_));
+      current_ += count;
+      n -= count;
     }
   }
 
   void assertNext(const char ch) {
     (void)ch;
     BENCODE_ASSERT(peek() == ch);
-    read();
+    next();
   }
 
 private:
-  void read() {
-    if (current_ < buffer_last_) {
-      ++current_;
-    } else if (!eof_) {
-      read_total_ += read_count_;
-
-      // if no eof
-      buffer_last_ = buffer_ + buffer_size_ - 1;
-      current_ = buffer_;
-
-      // eof
-      if (!stream_.read(buffer_, static_cast<std::streamsize>(buffer_size_))) {
-        read_count_ = static_cast<std::size_t>(stream_.gcount());
-        *(buffer_last_ = buffer_ + read_count_) = '\0';
-        eof_ = true;
-      }
+  // gives the bytes consumed from a borrowed get area back to the stream buffer
+  void commit() {
+    if (borrowed_ && current_ != begin_) {
+      (sb_->*&GetArea::gbump)(static_cast<int>(current_ - begin_));
+      begin_ = current_;
     }
   }
 
-  std::shared_ptr<std::string> &read(std::shared_ptr<std::string> &str,
-                                     const std::size_t n = 1) {
-    if (current_ + n <= buffer_last_) {
-      str->append(current_, n);
-      current_ += n;
-      return str;
-    } else if (!eof_) {
-      const std::size_t remaining = n - (buffer_last_ - current_ + 1);
-      const std::size_t need_read = n - remaining;
-      str->append(current_, remaining);
-
-      read_total_ += read_count_;
-
-      // if no eof
-      buffer_last_ = buffer_ + buffer_size_ - 1;
-      current_ = buffer_;
-
-      // eof
-      if (!stream_.read(buffer_, static_cast<std::streamsize>(buffer_size_))) {
-        read_count_ = static_cast<std::size_t>(stream_.gcount());
-        *(buffer_last_ = buffer_ + read_count_) = '\0';
-        eof_ = true;
-      }
+  bool fill() {
+    if (eof_) {
+      return false;
+    }
+    commit();
+
+    if (const char *gptr = (sb_->*&GetArea::gptr)(),
+                   *egptr = (sb_->*&GetArea::egptr)();
+        gptr != egptr) {
+      // gbump() takes an int, never borrow more than it can step over
+      constexpr auto kMaxBorrow =
+          static_cast<std::size_t>(std::numeric_limits<int>::max());
+      const auto size =
+          std::min(static_cast<std::size_t>(egptr - gptr), kMaxBorrow);
+      begin_ = current_ = gptr;
+      last_ = gptr + size;
+      borrowed_ = true;
+      fetched_ += size;
+      return true;
+    }
 
-      if (eof_ && need_read > read_count_) {
-        str->append(current_, read_count_);
-        return str;
-      }
+    const auto count =
+        sb_->sgetn(buffer_, static_cast<std::streamsize>(buffer_size_));
+    borrowed_ = false;
+    begin_ = current_ = buffer_;
+    last_ = buffer_ + std::max<std::streamsize>(count, 0);
+    fetched_ += static_cast<std::size_t>(last_ - current_);
+    eof_ = current_ == last_;
+    return !eof_;
+  }
 
-      return read(str, need_read);
+  // reads the rest of a span straight into the span string
+  void direct(const std::size_t n) {
+    while (span_.size() < n) {
+      const std::size_t size = span_.size();
+      const std::size_t count = std::min(n - size, kMaxDirectRead);
+      span_.resize(size + count);
+      const auto got =
+          sb_->sgetn(span_.data() + size, static_cast<std::streamsize>(count));
+      const auto read =
+          static_cast<std::size_t>(std::max<std::streamsize>(got, 0));
+      span_.resize(size + read);
+      fetched_ += read;
+      if (read < count) {
+        eof_ = true;
+        break;
+      }
     }
-
-    return str;
   }
 };
 
@@ -0,0 +1,137 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_KEY_TABLE_H_
+#define BENCODE_INCLUDE_BENCODE_KEY_TABLE_H_
+
+#include <cstdint>
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "bencode.h"
+#include "non_copyable.h"
+
+namespace bencode {
+
+/**
+ * @brief interns dict keys, every key with the same bytes is handed out as
+ * the same immutable string, so documents parsed with the table share their
+ * keys instead of allocating one per occurrence
+ *
+ * Only keys up to kMaxKeyLength bytes are interned and the table stops
+ * growing at max_keys, past that Intern falls back to a fresh string, so
+ * hostile input cannot make it grow without bound. A kThreadSafe table may
+ * be shared by parsers on several threads, ThreadLocal() gives every thread
+ * its own table without any locking.
+ */
+class KeyTable : NonCopyable {
+public:
+  enum Sharing { kSingleThread, kThreadSafe };
+
+  static constexpr std::size_t kMaxKeyLength = 64;
+  static constexpr std::size_t kDefaultMaxKeys = 4096;
+
+private:
+  // views into the interned strings, which never change once created
+  std::unordered_map<std::string_view, std::shared_ptr<std::string>> keys_;
+  mutable std::shared_mutex mutex_;
+  std::size_t max_keys_;
+  bool thread_safe_;
+
+public:
+  explicit KeyTable(const Sharing sharing = kSingleThread,
+                    const std::size_t max_keys = kDefaultMaxKeys)
+      : max_keys_(max_keys), thread_safe_(sharing == kThreadSafe) {}
+
+  /**
+   * @brief the interned string holding key, or a new string when key is not
+   * interned, the string must not be modified
+   */
+  std::shared_ptr<std::string> Intern(std::string_view key);
+
+  [[nodiscard]] std::size_t size() const;
+
+  /**
+   * @brief a single-thread table owned by the calling thread
+   */
+  static KeyTable &ThreadLocal();
+
+private:
+  [[nodiscard]] std::shared_ptr<std::string> Find(std::string_view key) const;
+};
+
+inline std::shared_ptr<std::string>
+KeyTable::Intern(const std::string_view key) {
+  if (key.size() > kMaxKeyLength) {
+    return std::make_shared<std::string>(key);
+  }
+
+  if (!thread_safe_) {
+    if (auto str = Find(key); str != nullptr) {
+      return str;
+    }
+  } else {
+    std::shared_lock lock(mutex_);
+    if (auto str = Find(key); str != nullptr) {
+      return str;
+    }
+  }
+
+  auto str = std::make_shared<std::string>(key);
+  std::unique_lock lock(mutex_, std::defer_lock);
+  if (thread_safe_) {
+    lock.lock();
+  }
+  if (keys_.size() >= max_keys_) {
+    return str;
+  }
+  // another thread may have interned the key since the lookup
+  return keys_.try_emplace(*str, str).first->second;
+}
+
+inline std::size_t KeyTable::size() const {
+  std::shared_lock lock(mutex_, std::defer_lock);
+  if (thread_safe_) {
+    lock.lock();
+  }
+  return keys_.size();
+}
+
+inline KeyTable &KeyTable::ThreadLocal() {
+  thread_local KeyTable table;
+  return table;
+}
+
+inline std::shared_ptr<std::string>
+KeyTable::Find(const std::string_view key) const {
+  const auto it = keys_.find(key);
+  return it != keys_.end() ? it->second : nullptr;
+}
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_KEY_TABLE_H_
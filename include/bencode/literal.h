@@ -0,0 +1,413 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_LITERAL_H_
+#define BENCODE_INCLUDE_BENCODE_LITERAL_H_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include "bencode.h"
+#include "exception.h"
+#include "internal/itoa.h"
+#include "value.h"
+
+namespace bencode {
+
+/**
+ * @brief one value of a Literal, entries are laid out in document order and
+ * the keys of a dict are B_STRING entries in front of their values
+ */
+struct TapeEntry {
+  Type type_ = B_NULL;
+  int64_t integer_ = 0;
+  // payload of a string, as a position in the literal text
+  std::size_t offset_ = 0;
+  // string length, list elements or dict members
+  std::size_t size_ = 0;
+  // index of the entry after this value and everything inside it
+  std::size_t next_ = 0;
+};
+
+template <std::size_t N> class Literal;
+
+template <std::size_t N>
+constexpr Literal<N> ParseLiteral(std::string_view bencode);
+
+/**
+ * @brief canonical bencode of at most N bytes, checked and indexed by
+ * ParseLiteral, usually at compile time
+ *
+ * The smallest value takes two bytes ("0:", "le", "de"), so a tape of N / 2
+ * entries is always enough and nothing is allocated.
+ */
+template <std::size_t N> class Literal {
+public:
+  static constexpr std::size_t kTapeCapacity = N / 2 + 1;
+
+private:
+  std::array<char, N> text_{};
+  std::array<TapeEntry, kTapeCapacity> tape_{};
+  // takes the values of a malformed text once the tape is full, parsing goes
+  // on so the error reported is the one in the text
+  TapeEntry spare_{};
+  std::size_t size_ = 0;
+  std::size_t tape_size_ = 0;
+
+  friend constexpr Literal ParseLiteral<N>(std::string_view bencode);
+
+public:
+  [[nodiscard]] constexpr std::string_view view() const {
+    return {text_.data(), size_};
+  }
+
+  [[nodiscard]] constexpr std::span<const TapeEntry> tape() const {
+    return {tape_.data(), tape_size_};
+  }
+
+  [[nodiscard]] constexpr std::string_view
+  GetString(const TapeEntry &entry) const {
+    BENCODE_ASSERT(entry.type_ == B_STRING);
+    return view().substr(entry.offset_, entry.size_);
+  }
+
+  /**
+   * @brief index of the value stored under key in the dict at index dict, or
+   * tape().size() when there is none
+   */
+  [[nodiscard]] constexpr std::size_t FindMember(const std::size_t dict,
+                                                 std::string_view key) const;
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  constexpr bool WriteTo(Handler &handler) const {
+    return WriteTo(0, handler) == tape_size_;
+  }
+
+private:
+  static constexpr bool IsDigit(const char ch) {
+    return ch >= '0' && ch <= '9';
+  }
+
+  [[nodiscard]] constexpr char Peek(const std::size_t pos) const {
+    return pos < size_ ? text_[pos] : '\0';
+  }
+
+  constexpr void Parse(std::string_view bencode);
+  constexpr std::size_t ParseValue(std::size_t pos);
+  constexpr std::size_t ParseInteger(std::size_t pos);
+  constexpr std::size_t ParseString(std::size_t pos, std::string_view &str);
+  constexpr std::size_t ParseList(std::size_t pos);
+  constexpr std::size_t ParseDict(std::size_t pos);
+  constexpr TapeEntry &Push(Type type);
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  constexpr std::size_t WriteTo(std::size_t index, Handler &handler) const;
+};
+
+/**
+ * @brief checks and indexes bencode, in a constant expression any error is a
+ * compile error naming the Exception, at run time the Exception is thrown
+ *
+ * Only canonical bencode is accepted: integers without '+', leading zeros or
+ * -0, string lengths without leading zeros and dict keys in strictly ascending
+ * byte order, the same rules as kParseCanonicalFlags.
+ */
+template <std::size_t N>
+constexpr Literal<N> ParseLiteral(const std::string_view bencode) {
+  Literal<N> literal;
+  literal.Parse(bencode);
+  return literal;
+}
+
+template <std::size_t N>
+constexpr Literal<N - 1> ParseLiteral(const char (&bencode)[N]) {
+  return ParseLiteral<N - 1>(std::string_view(bencode, N - 1));
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::FindMember(const std::size_t dict,
+                                             const std::string_view key) const {
+  BENCODE_ASSERT(dict < tape_size_ && tape_[dict].type_ == B_DICT);
+  std::size_t index = dict + 1;
+  for (std::size_t i = 0; i < tape_[dict].size_; ++i) {
+    if (GetString(tape_[index]) == key) {
+      return index + 1;
+    }
+    index = tape_[index + 1].next_;
+  }
+  return tape_size_;
+}
+
+template <std::size_t N>
+constexpr void Literal<N>::Parse(const std::string_view bencode) {
+  if (bencode.size() > N) {
+    throw Exception(error::TOTAL_BYTES_EXCEEDED);
+  }
+  std::copy(bencode.begin(), bencode.end(), text_.begin());
+  size_ = bencode.size();
+
+  if (ParseValue(0) != size_) {
+    throw Exception(error::ROOT_NOT_SINGULAR);
+  }
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::ParseValue(const std::size_t pos) {
+  if (pos == size_) {
+    throw Exception(error::EXPECT_VALUE);
+  }
+
+  switch (Peek(pos)) {
+  case 'd':
+    return ParseDict(pos);
+  case 'i':
+    return ParseInteger(pos);
+  case 'l':
+    return ParseList(pos);
+  default:
+    if (IsDigit(Peek(pos))) {
+      std::string_view str;
+      return ParseString(pos, str);
+    }
+    throw Exception(error::BAD_VALUE);
+  }
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::ParseInteger(std::size_t pos) {
+  TapeEntry &entry = Push(B_INTEGER);
+
+  ++pos; // 'i'
+  if (Peek(pos) == '+') {
+    throw Exception(error::LEADING_PLUS);
+  }
+  const bool negative = Peek(pos) == '-';
+  if (negative) {
+    ++pos;
+  }
+  if (Peek(pos) == '0') {
+    if (negative) {
+      throw Exception(error::NEGATIVE_ZERO);
+    }
+    if (IsDigit(Peek(++pos))) {
+      throw Exception(error::LEADING_ZERO);
+    }
+  } else if (!IsDigit(Peek(pos))) {
+    throw Exception(error::BAD_VALUE);
+  }
+
+  // the magnitude of INT64_MIN is one past INT64_MAX
+  const uint64_t max = static_cast<uint64_t>(
+                           (std::numeric_limits<int64_t>::max)()) +
+                       (negative ? 1 : 0);
+  uint64_t u64 = 0;
+  for (; IsDigit(Peek(pos)); ++pos) {
+    const auto digit = static_cast<uint64_t>(Peek(pos) - '0');
+    if (u64 > (max - digit) / 10) {
+      throw Exception(error::NUMBER_TOO_BIG);
+    }
+    u64 = u64 * 10 + digit;
+  }
+  entry.integer_ = static_cast<int64_t>(negative ? ~u64 + 1 : u64);
+
+  if (Peek(pos) != 'e') {
+    throw Exception(error::MISS_TRAILING_E);
+  }
+  entry.next_ = tape_size_;
+  return pos + 1;
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::ParseString(std::size_t pos,
+                                              std::string_view &str) {
+  TapeEntry &entry = Push(B_STRING);
+
+  if (!IsDigit(Peek(pos))) {
+    throw Exception(error::MISS_STRING_LENGTH);
+  }
+  if (Peek(pos) == '0' && IsDigit(Peek(pos + 1))) {
+    throw Exception(error::LEADING_ZERO);
+  }
+  std::size_t length = 0;
+  for (; IsDigit(Peek(pos)); ++pos) {
+    const auto digit = static_cast<std::size_t>(Peek(pos) - '0');
+    // a length past the end of the text is reported below anyway
+    if (length > size_) {
+      throw Exception(error::MISS_STRING_DATA);
+    }
+    length = length * 10 + digit;
+  }
+  if (Peek(pos++) != ':') {
+    throw Exception(error::MISS_COLON);
+  }
+  if (length > size_ - pos) {
+    throw Exception(error::MISS_STRING_DATA);
+  }
+
+  entry.offset_ = pos;
+  entry.size_ = length;
+  entry.next_ = tape_size_;
+  str = view().substr(pos, length);
+  return pos + length;
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::ParseList(std::size_t pos) {
+  TapeEntry &entry = Push(B_LIST);
+
+  std::size_t size = 0;
+  for (++pos; Peek(pos) != 'e'; ++size) {
+    pos = ParseValue(pos);
+  }
+
+  entry.size_ = size;
+  entry.next_ = tape_size_;
+  return pos + 1;
+}
+
+template <std::size_t N>
+constexpr std::size_t Literal<N>::ParseDict(std::size_t pos) {
+  TapeEntry &entry = Push(B_DICT);
+
+  std::size_t size = 0;
+  std::string_view previous;
+  for (++pos; Peek(pos) != 'e'; ++size) {
+    if (!IsDigit(Peek(pos))) {
+      throw Exception(error::MISS_KEY);
+    }
+    std::string_view key;
+    pos = ParseString(pos, key);
+    if (size != 0 && key <= previous) {
+      throw Exception(key == previous ? error::DUPLICATE_KEY
+                                      : error::UNSORTED_KEYS);
+    }
+    previous = key;
+    pos = ParseValue(pos);
+  }
+
+  entry.size_ = size;
+  entry.next_ = tape_size_;
+  return pos + 1;
+}
+
+template <std::size_t N>
+constexpr TapeEntry &Literal<N>::Push(const Type type) {
+  // every value owns at least two bytes of the text, so only malformed text
+  // can run out of room
+  TapeEntry &entry = tape_size_ < kTapeCapacity ? tape_[tape_size_++] : spare_;
+  entry.type_ = type;
+  return entry;
+}
+
+#define CALL_HANDLER(expr)                                                     \
+  do {                                                                         \
+    if (!(expr)) {                                                             \
+      return tape_size_ + 1;                                                   \
+    }                                                                          \
+  } while (false)
+
+template <std::size_t N>
+template <required::handler::HasAllRequiredFunctions Handler>
+constexpr std::size_t Literal<N>::WriteTo(std::size_t index,
+                                          Handler &handler) const {
+  const TapeEntry &entry = tape_[index];
+  switch (entry.type_) {
+  case B_INTEGER:
+    CALL_HANDLER(handler.Integer(entry.integer_));
+    break;
+  case B_STRING:
+    CALL_HANDLER(handler.String(GetString(entry)));
+    break;
+  case B_LIST:
+    CALL_HANDLER(handler.StartList());
+    for (++index; index < entry.next_;) {
+      index = WriteTo(index, handler);
+    }
+    CALL_HANDLER(index == entry.next_ && handler.EndList());
+    break;
+  case B_DICT:
+    CALL_HANDLER(handler.StartDict());
+    for (++index; index < entry.next_;) {
+      CALL_HANDLER(handler.Key(GetString(tape_[index])));
+      index = WriteTo(index + 1, handler);
+    }
+    CALL_HANDLER(index == entry.next_ && handler.EndDict());
+    break;
+  default:
+    BENCODE_ASSERT(false && "bad type");
+  }
+  return entry.next_;
+}
+
+#undef CALL_HANDLER
+
+/**
+ * @brief a handler that encodes into a fixed buffer of N bytes, so message
+ * templates can be assembled in a constant expression and fed to ParseLiteral
+ */
+template <std::size_t N> class LiteralWriter {
+  std::array<char, N> buffer_{};
+  std::size_t size_ = 0;
+
+public:
+  [[nodiscard]] constexpr std::string_view view() const {
+    return {buffer_.data(), size_};
+  }
+
+  constexpr bool Null() { return true; }
+  constexpr bool Integer(const int64_t i64) {
+    char buf[internal::kMaxEncodedIntegerSize]{};
+    const char *end = internal::i64toa_list(std::span(&i64, 1), buf);
+    return Append(std::string_view(buf, static_cast<std::size_t>(end - buf)));
+  }
+  constexpr bool String(const std::string_view str) {
+    char buf[internal::kMaxEncodedIntegerSize]{};
+    char *end = internal::u64toa(str.size(), buf);
+    *end++ = ':';
+    return Append(std::string_view(buf, static_cast<std::size_t>(end - buf))) &&
+           Append(str);
+  }
+  constexpr bool Key(const std::string_view str) { return String(str); }
+  constexpr bool StartList() { return Append("l"); }
+  constexpr bool EndList() { return Append("e"); }
+  constexpr bool StartDict() { return Append("d"); }
+  constexpr bool EndDict() { return Append("e"); }
+
+private:
+  constexpr bool Append(const std::string_view str) {
+    if (str.size() > N - size_) {
+      throw Exception(error::TOTAL_BYTES_EXCEEDED);
+    }
+    std::copy(str.begin(), str.end(), buffer_.begin() + size_);
+    size_ += str.size();
+    return true;
+  }
+};
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_LITERAL_H_
@@ -0,0 +1,200 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_METAINFO_H_
+#define BENCODE_INCLUDE_BENCODE_METAINFO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bencode.h"
+#include "exception.h"
+#include "value.h"
+
+namespace bencode {
+
+/**
+ * @brief the SHA-1 hash of one piece
+ */
+using Digest = std::array<std::byte, 20>;
+
+static_assert(sizeof(Digest) == 20 && alignof(Digest) == 1);
+
+/**
+ * @brief one digest seen in place, e.g. inside a parsed pieces string
+ */
+using DigestView = std::span<const std::byte, sizeof(Digest)>;
+
+/**
+ * @brief the digests of a pieces string as 20-byte views of its bytes, no
+ * Digest objects live there so they are not handed out as such
+ */
+class PieceDigests {
+  std::span<const std::byte> bytes_;
+
+public:
+  PieceDigests() = default;
+  explicit PieceDigests(const std::span<const std::byte> bytes)
+      : bytes_(bytes) {
+    BENCODE_ASSERT(bytes.size() % sizeof(Digest) == 0);
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return bytes_.size() / sizeof(Digest);
+  }
+  [[nodiscard]] bool empty() const { return bytes_.empty(); }
+  [[nodiscard]] std::span<const std::byte> bytes() const { return bytes_; }
+
+  [[nodiscard]] DigestView operator[](const std::size_t index) const {
+    BENCODE_ASSERT(index < size());
+    return DigestView(bytes_.data() + index * sizeof(Digest), sizeof(Digest));
+  }
+
+  /**
+   * @brief a copy of the digest at index
+   */
+  [[nodiscard]] Digest at(const std::size_t index) const {
+    if (index >= size()) {
+      throw std::out_of_range("piece index out of range");
+    }
+    Digest digest;
+    std::memcpy(digest.data(), bytes_.data() + index * sizeof(Digest),
+                sizeof(Digest));
+    return digest;
+  }
+};
+
+/**
+ * @brief typed, checked access to the metainfo of a torrent
+ *
+ * The root is held by value, which only shares the parsed tree, so the
+ * Document it came from may go away. Strings parsed with kParseNoCopyFlag
+ * still point into the input, which has to outlive it.
+ *
+ * Every accessor throws Exception, MISS_MEMBER when a member is absent,
+ * TYPE_MISMATCH when it has the wrong type.
+ */
+class Metainfo {
+  Value root_;
+
+public:
+  explicit Metainfo(Value root) : root_(std::move(root)) {}
+
+  [[nodiscard]] const Value &Info() const { return Member(root_, "info"); }
+
+  [[nodiscard]] int64_t PieceLength() const;
+
+  /**
+   * @brief the digests of info.pieces, viewed in place in the parsed string,
+   * throws BAD_PIECES unless its length is a multiple of 20
+   */
+  [[nodiscard]] PieceDigests Pieces() const;
+
+private:
+  static const Value &Member(const Value &dict, std::string_view key);
+};
+
+inline int64_t Metainfo::PieceLength() const {
+  const auto &length = Member(Info(), "piece length");
+  if (!length.IsInteger()) {
+    throw Exception(error::TYPE_MISMATCH);
+  }
+  return length.GetInteger();
+}
+
+inline PieceDigests Metainfo::Pieces() const {
+  const auto &pieces = Member(Info(), "pieces");
+  if (!pieces.IsString()) {
+    throw Exception(error::TYPE_MISMATCH);
+  }
+  const auto bytes = std::as_bytes(std::span(pieces.GetStringView()));
+  if (bytes.size() % sizeof(Digest) != 0) {
+    throw Exception(error::BAD_PIECES);
+  }
+  return PieceDigests(bytes);
+}
+
+inline const Value &Metainfo::Member(const Value &dict,
+                                     const std::string_view key) {
+  if (!dict.IsDict()) {
+    throw Exception(error::TYPE_MISMATCH);
+  }
+  const auto it = dict.FindMember(key);
+  if (it == dict.MemberEnd()) {
+    throw Exception(error::MISS_MEMBER);
+  }
+  return it->value_;
+}
+
+/**
+ * @brief writes the runs of digests as the single string value of pieces,
+ * streamed in chunks when the handler takes them so nothing is staged
+ */
+template <required::handler::HasAllRequiredFunctions Handler>
+bool WritePieces(Handler &handler,
+                 const std::span<const std::span<const Digest>> runs) {
+  std::size_t length = 0;
+  for (const auto run : runs) {
+    length += run.size_bytes();
+  }
+
+  const auto bytes = [](const std::span<const Digest> run) {
+    return std::string_view(reinterpret_cast<const char *>(run.data()),
+                            run.size_bytes());
+  };
+
+  if constexpr (required::handler::HasStringChunks<Handler>) {
+    if (!handler.StringStart(length)) {
+      return false;
+    }
+    for (const auto run : runs) {
+      if (!run.empty() && !handler.StringChunk(bytes(run))) {
+        return false;
+      }
+    }
+    return handler.StringEnd();
+  } else {
+    std::string pieces;
+    pieces.reserve(length);
+    for (const auto run : runs) {
+      pieces.append(bytes(run));
+    }
+    return handler.String(pieces);
+  }
+}
+
+template <required::handler::HasAllRequiredFunctions Handler>
+bool WritePieces(Handler &handler, const std::span<const Digest> digests) {
+  return WritePieces(handler, std::span(&digests, 1));
+}
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_METAINFO_H_
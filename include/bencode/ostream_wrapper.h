@@ -27,32 +27,105 @@
 #ifndef BENCODE_INCLUDE_BENCODE_OSTREAM_WRAPPER_H_
 #define BENCODE_INCLUDE_BENCODE_OSTREAM_WRAPPER_H_
 
+#include <cstring>
+
 #include <sstream>
 #include <string_view>
 
+#include "bencode.h"
 #include "non_copyable.h"
 
 namespace bencode {
 
+/**
+ * @brief write stream over any std::ostream
+ *
+ * Bytes are collected in a buffer and handed to the stream with one write()
+ * per block, flush() writes out the pending bytes and flushes the stream.
+ */
 template <class Stream> class OStreamWrapper : NonCopyable {
 public:
   using Ch = typename Stream::char_type;
 
 private:
+  static constexpr std::size_t kInnerBufferSize = 256;
   Stream &stream_;
+  Ch inner_buffer_[kInnerBufferSize]{};
+  Ch *buffer_;
+  Ch *buffer_end_;
+  Ch *current_;
 
 public:
-  explicit OStreamWrapper(Stream &stream) : stream_(stream) {}
+  explicit OStreamWrapper(Stream &stream)
+      : stream_(stream), buffer_(inner_buffer_),
+        buffer_end_(buffer_ + kInnerBufferSize), current_(buffer_) {}
+
+  OStreamWrapper(Stream &stream, Ch *buffer, const std::size_t buffer_size)
+      : stream_(stream), buffer_(buffer), buffer_end_(buffer + buffer_size),
+        current_(buffer_) {
+    BENCODE_ASSERT(buffer_size > 0 && "buffer size should not be zero");
+  }
+
+  template <std::size_t N>
+  OStreamWrapper(Stream &stream, Ch (&buffer)[N])
+      : OStreamWrapper(stream, buffer, N) {}
 
-  void put(Ch ch) { stream_.put(ch); }
+  ~OStreamWrapper() { write(); }
 
-  void puts(const char *str, std::streamsize length) {
-    stream_.write(str, length);
+  void put(const Ch ch) {
+    if (current_ >= buffer_end_) {
+      write();
+    }
+    *current_++ = ch;
   }
 
-  void put_sv(std::string_view sv) const { stream_ << sv; }
+  void put_n(const Ch ch, std::size_t size) {
+    auto avail = static_cast<std::size_t>(buffer_end_ - current_);
+    while (size > avail) {
+      std::memset(current_, ch, avail);
+      current_ += avail;
+      write();
+      size -= avail;
+      avail = static_cast<std::size_t>(buffer_end_ - current_);
+    }
+    if (size > 0) {
+      std::memset(current_, ch, size);
+      current_ += size;
+    }
+  }
+
+  void puts(const Ch *str, const std::size_t length) {
+    if (length <= static_cast<std::size_t>(buffer_end_ - current_)) {
+      std::memcpy(current_, str, length);
+      current_ += length;
+      return;
+    }
 
-  void flush() { stream_.flush(); }
+    // too large for the buffer, write it out in a single block behind the
+    // pending bytes
+    write();
+    if (length < static_cast<std::size_t>(buffer_end_ - buffer_)) {
+      std::memcpy(current_, str, length);
+      current_ += length;
+    } else {
+      stream_.write(str, static_cast<std::streamsize>(length));
+    }
+  }
+
+  void put_sv(const std::string_view sv) { puts(sv.data(), sv.size()); }
+
+  void flush() {
+    write();
+    stream_.flush();
+  }
+
+private:
+  void write() {
+    if (current_ != buffer_) {
+      stream_.write(buffer_, static_cast<std::streamsize>(current_ - buffer_));
+      current_ = buffer_;
+    }
+  }
 };
 
 } // namespace bencode
@@ -0,0 +1,209 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_PARSE_STATS_H_
+#define BENCODE_INCLUDE_BENCODE_PARSE_STATS_H_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <string_view>
+#include <vector>
+
+#include "bencode.h"
+#include "value.h"
+
+namespace bencode {
+
+/**
+ * @brief shape of a parsed document, filled in by StatsHandler
+ */
+struct ParseStats {
+  std::size_t integers_ = 0;
+  std::size_t strings_ = 0;
+  std::size_t keys_ = 0;
+  std::size_t lists_ = 0;
+  std::size_t dicts_ = 0;
+
+  // payload bytes of string values and of keys, length prefixes excluded
+  std::size_t string_bytes_ = 0;
+  std::size_t key_bytes_ = 0;
+  std::size_t largest_string_ = 0;
+
+  // most containers open at once, a document without any has depth zero
+  std::size_t max_depth_ = 0;
+  std::size_t max_dict_size_ = 0;
+  // bucket 0 counts empty dicts, bucket i dicts of [2^(i-1), 2^i) members
+  std::array<std::size_t, 65> dict_size_histogram_{};
+
+  // whole parse and the part of it spent inside the wrapped handler, the
+  // latter is estimated from a sample of the events, so the split between
+  // tokenizer and handler is approximate
+  std::chrono::nanoseconds total_time_{0};
+  std::chrono::nanoseconds handler_time_{0};
+
+  [[nodiscard]] std::chrono::nanoseconds tokenizer_time() const {
+    return total_time_ - handler_time_;
+  }
+};
+
+/**
+ * @brief forwards every event to handler and records it in stats, wrap a
+ * handler with it to opt into statistics, a plain parse never instantiates it
+ * and pays nothing
+ *
+ * Reading the clock costs more than handling a small token, so only one event
+ * in kSampleInterval is timed and stands for the others. Run() caps the
+ * estimate at the time the parse took.
+ */
+template <required::handler::HasAllRequiredFunctions Handler,
+          class Clock = std::chrono::steady_clock>
+class StatsHandler {
+public:
+  static constexpr std::size_t kSampleInterval = 64;
+
+private:
+  Handler &handler_;
+  ParseStats &stats_;
+  std::size_t depth_ = 0;
+  std::size_t events_ = 0;
+  // member count of every open dict, innermost last
+  std::vector<std::size_t> dict_sizes_;
+
+public:
+  StatsHandler(Handler &handler, ParseStats &stats)
+      : handler_(handler), stats_(stats), dict_sizes_() {}
+
+  /**
+   * @brief runs parse, a callable taking this handler, and records the time it
+   * took as the total time
+   */
+  template <typename Parse> auto Run(Parse &&parse) {
+    const auto handler_time = stats_.handler_time_;
+    const auto start = Clock::now();
+    auto ret = parse(*this);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start);
+    stats_.total_time_ += elapsed;
+    stats_.handler_time_ =
+        handler_time + std::min(stats_.handler_time_ - handler_time, elapsed);
+    return ret;
+  }
+
+  bool Null() {
+    return Timed([this] { return handler_.Null(); });
+  }
+
+  bool Integer(const int64_t i64) {
+    ++stats_.integers_;
+    return Timed([this, i64] { return handler_.Integer(i64); });
+  }
+
+  bool String(const std::string_view str) {
+    CountString(str.size());
+    return Timed([this, str] { return handler_.String(str); });
+  }
+
+  bool Key(const std::string_view str) {
+    ++stats_.keys_;
+    stats_.key_bytes_ += str.size();
+    BENCODE_ASSERT(!dict_sizes_.empty());
+    ++dict_sizes_.back();
+    return Timed([this, str] { return handler_.Key(str); });
+  }
+
+  bool StartList() {
+    ++stats_.lists_;
+    Enter();
+    return Timed([this] { return handler_.StartList(); });
+  }
+
+  bool EndList() {
+    --depth_;
+    return Timed([this] { return handler_.EndList(); });
+  }
+
+  bool StartDict() {
+    ++stats_.dicts_;
+    Enter();
+    dict_sizes_.push_back(0);
+    return Timed([this] { return handler_.StartDict(); });
+  }
+
+  bool EndDict() {
+    --depth_;
+    const std::size_t size = dict_sizes_.back();
+    dict_sizes_.pop_back();
+    stats_.max_dict_size_ = std::max(stats_.max_dict_size_, size);
+    ++stats_.dict_size_histogram_[std::bit_width(size)];
+    return Timed([this] { return handler_.EndDict(); });
+  }
+
+  bool StringStart(const std::size_t length)
+    requires required::handler::HasStringChunks<Handler>
+  {
+    CountString(length);
+    return Timed([this, length] { return handler_.StringStart(length); });
+  }
+
+  bool StringChunk(const std::string_view chunk)
+    requires required::handler::HasStringChunks<Handler>
+  {
+    return Timed([this, chunk] { return handler_.StringChunk(chunk); });
+  }
+
+  bool StringEnd()
+    requires required::handler::HasStringChunks<Handler>
+  {
+    return Timed([this] { return handler_.StringEnd(); });
+  }
+
+private:
+  // times the first event of every kSampleInterval
+  template <typename Event> bool Timed(Event &&event) {
+    if (events_++ % kSampleInterval != 0) {
+      return event();
+    }
+    const auto start = Clock::now();
+    const bool ret = event();
+    stats_.handler_time_ +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start) *
+        kSampleInterval;
+    return ret;
+  }
+
+  void Enter() { stats_.max_depth_ = std::max(stats_.max_depth_, ++depth_); }
+
+  void CountString(const std::size_t length) {
+    ++stats_.strings_;
+    stats_.string_bytes_ += length;
+    stats_.largest_string_ = std::max(stats_.largest_string_, length);
+  }
+};
+
+} // namespace bencode
+
+#endif // BENCODE_INCLUDE_BENCODE_PARSE_STATS_H_
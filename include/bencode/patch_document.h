@@ -0,0 +1,307 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_INCLUDE_BENCODE_PATCH_DOCUMENT_H_
+#define BENCODE_INCLUDE_BENCODE_PATCH_DOCUMENT_H_
+
+#include <cstdint>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bencode.h"
+#include "document.h"
+#include "exception.h"
+#include "internal/skip.h"
+#include "reader.h"
+#include "string_write_stream.h"
+#include "value.h"
+#include "writer.h"
+
+#ifdef __GNUC__
+BENCODE_DIAG_PUSH
+BENCODE_DIAG_OFF(effc++)
+#endif // __GNUC__
+
+namespace bencode {
+
+/**
+ * @brief one dict of a PatchDocument
+ *
+ * Members are indexed as spans of the source bytes and only turned into values
+ * when asked for. Members that are never replaced, removed or patched are
+ * written back byte-for-byte, an untouched dict as a whole.
+ */
+class PatchDict {
+  struct Entry {
+    std::string key_;
+    std::string_view raw_;
+    std::optional<Value> value_;
+    std::unique_ptr<PatchDict> dict_;
+  };
+
+  std::vector<Entry> entries_;
+  std::string_view raw_;
+  bool modified_ = false;
+
+public:
+  [[nodiscard]] std::size_t GetSize() const { return entries_.size(); }
+  [[nodiscard]] bool HasMember(std::string_view key) const;
+
+  /**
+   * @brief original encoding of a member, empty once it has been replaced or
+   * patched
+   */
+  [[nodiscard]] std::string_view GetRaw(std::string_view key) const;
+  /**
+   * @brief a member as a value, parsed from its bytes unless it was replaced,
+   * throws Exception with the parse error if they do not parse
+   */
+  [[nodiscard]] Value GetMember(std::string_view key) const;
+
+  void SetMember(std::string_view key, Value value);
+  bool RemoveMember(std::string_view key);
+
+  /**
+   * @brief opens a dict member for patching its own members
+   */
+  PatchDict &PatchMember(std::string_view key);
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  bool WriteTo(Handler &handler) const;
+
+protected:
+  std::size_t Index(std::string_view bencode, std::size_t pos);
+  void Clear();
+
+private:
+  std::vector<Entry>::iterator Find(std::string_view key);
+  [[nodiscard]] std::vector<Entry>::const_iterator
+  Find(std::string_view key) const;
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  static bool WriteEntry(const Entry &entry, Handler &handler);
+};
+
+/**
+ * @brief parses a dict for editing a few members and re-serializing it with
+ * every untouched subtree copied from the source bytes
+ *
+ * The document refers to the parsed bytes, they must outlive it.
+ */
+class PatchDocument : public PatchDict {
+public:
+  error::ParseError Parse(std::string_view bencode);
+};
+
+inline bool PatchDict::HasMember(const std::string_view key) const {
+  return Find(key) != entries_.end();
+}
+
+inline std::string_view PatchDict::GetRaw(const std::string_view key) const {
+  const auto it = Find(key);
+  BENCODE_ASSERT(it != entries_.end() && "member no found");
+  if (it == entries_.end() || it->value_ || it->dict_) {
+    return {};
+  }
+  return it->raw_;
+}
+
+inline Value PatchDict::GetMember(const std::string_view key) const {
+  const auto it = Find(key);
+  BENCODE_ASSERT(it != entries_.end() && "member no found");
+  if (it == entries_.end()) {
+    return Value(B_NULL);
+  }
+  if (it->value_) {
+    return *it->value_;
+  }
+
+  // a patched dict is encoded first, so its members are parsed in one go and
+  // a parse error is not lost in a replay
+  std::string_view bencode = it->raw_;
+  StringWriteStream os;
+  if (it->dict_) {
+    Writer writer(os);
+    it->dict_->WriteTo(writer);
+    bencode = os.get();
+  }
+
+  Document doc;
+  if (const auto err = doc.Parse(bencode); err != error::OK) {
+    throw Exception(err);
+  }
+  return static_cast<Value &>(doc);
+}
+
+inline void PatchDict::SetMember(const std::string_view key, Value value) {
+  modified_ = true;
+  if (const auto it = Find(key); it != entries_.end()) {
+    it->raw_ = {};
+    it->value_ = std::move(value);
+    it->dict_.reset();
+    return;
+  }
+
+  // keep the keys sorted as bencode requires
+  const auto pos = std::ranges::find_if(
+      entries_, [key](const Entry &entry) { return key < entry.key_; });
+  entries_.insert(pos, Entry{std::string(key), {}, std::move(value), {}});
+}
+
+inline bool PatchDict::RemoveMember(const std::string_view key) {
+  const auto it = Find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  entries_.erase(it);
+  modified_ = true;
+  return true;
+}
+
+inline PatchDict &PatchDict::PatchMember(const std::string_view key) {
+  const auto it = Find(key);
+  BENCODE_ASSERT(it != entries_.end() && "member no found");
+  if (!it->dict_) {
+    BENCODE_ASSERT(!it->value_ && "member has been replaced");
+    BENCODE_ASSERT(!it->raw_.empty() && it->raw_.front() == 'd' &&
+                   "member is not a dict");
+    it->dict_ = std::make_unique<PatchDict>();
+    it->dict_->Index(it->raw_, 0);
+  }
+  modified_ = true;
+  return *it->dict_;
+}
+
+#define CALL_HANDLER(expr)                                                     \
+  do {                                                                         \
+    if (!(expr)) {                                                             \
+      return false;                                                            \
+    }                                                                          \
+  } while (false)
+
+template <required::handler::HasAllRequiredFunctions Handler>
+bool PatchDict::WriteTo(Handler &handler) const {
+  if (!modified_ && !raw_.empty()) {
+    return internal::WriteRaw(raw_, handler);
+  }
+
+  CALL_HANDLER(handler.StartDict());
+  for (const auto &entry : entries_) {
+    CALL_HANDLER(handler.Key(entry.key_));
+    CALL_HANDLER(WriteEntry(entry, handler));
+  }
+  CALL_HANDLER(handler.EndDict());
+  return true;
+}
+
+template <required::handler::HasAllRequiredFunctions Handler>
+bool PatchDict::WriteEntry(const Entry &entry, Handler &handler) {
+  if (entry.dict_) {
+    return entry.dict_->WriteTo(handler);
+  }
+  if (entry.value_) {
+    return entry.value_->WriteTo(handler);
+  }
+  return internal::WriteRaw(entry.raw_, handler);
+}
+
+#undef CALL_HANDLER
+
+inline std::size_t PatchDict::Index(const std::string_view bencode,
+                                    std::size_t pos) {
+  const std::size_t start = pos;
+  if (pos >= bencode.size() || bencode[pos] != 'd') {
+    throw Exception(error::MISS_INITIAL_D);
+  }
+  ++pos;
+
+  while (true) {
+    if (pos >= bencode.size()) {
+      throw Exception(error::MISS_TRAILING_E);
+    }
+    if (bencode[pos] == 'e') {
+      ++pos;
+      break;
+    }
+    if (bencode[pos] < '0' || bencode[pos] > '9') {
+      throw Exception(error::MISS_KEY);
+    }
+
+    const std::size_t length = internal::ScanStringLength(bencode, pos);
+    const auto key = bencode.substr(pos, length);
+    pos += length;
+
+    const std::size_t end = internal::SkipValue(bencode, pos);
+    entries_.push_back(
+        Entry{std::string(key), bencode.substr(pos, end - pos), {}, {}});
+    pos = end;
+  }
+
+  raw_ = bencode.substr(start, pos - start);
+  return pos;
+}
+
+inline void PatchDict::Clear() {
+  entries_.clear();
+  raw_ = {};
+  modified_ = false;
+}
+
+inline std::vector<PatchDict::Entry>::iterator
+PatchDict::Find(const std::string_view key) {
+  return std::ranges::find_if(
+      entries_, [key](const Entry &entry) { return entry.key_ == key; });
+}
+
+inline std::vector<PatchDict::Entry>::const_iterator
+PatchDict::Find(const std::string_view key) const {
+  return const_cast<PatchDict &>(*this).Find(key);
+}
+
+inline error::ParseError PatchDocument::Parse(const std::string_view bencode) {
+  Clear();
+  try {
+    if (bencode.empty()) {
+      throw Exception(error::EXPECT_VALUE);
+    }
+    if (Index(bencode, 0) != bencode.size()) {
+      throw Exception(error::ROOT_NOT_SINGULAR);
+    }
+    return error::OK;
+  } catch (Exception &e) {
+    Clear();
+    return e.err();
+  }
+}
+
+} // namespace bencode
+
+#ifdef __GNUC__
+BENCODE_DIAG_POP
+#endif // __GNUC__
+
+#endif // BENCODE_INCLUDE_BENCODE_PATCH_DOCUMENT_H_
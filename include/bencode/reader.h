@@ -29,10 +29,16 @@
 
 #include <cstdint>
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "exception.h"
 #include "non_copyable.h"
+#include "string_read_stream.h"
 #include "value.h"
 
 namespace bencode {
@@ -62,6 +68,11 @@ concept HasNextWithLength = requires(ReadStream rs, std::size_t n) {
   { rs.next(n) } -> std::same_as<std::string_view>;
 };
 
+template <typename ReadStream>
+concept HasNextChunk = requires(ReadStream rs, std::size_t n) {
+  { rs.nextChunk(n) } -> std::same_as<std::string_view>;
+};
+
 template <typename ReadStream>
 concept HasAssertNext = requires(ReadStream rs, char ch) {
   { rs.assertNext(ch) } -> std::same_as<void>;
@@ -76,44 +87,261 @@ concept HasAllRequiredFunctions =
 
 } // namespace required::read_stream
 
+/**
+ * @brief behaviour of Reader::Parse, chosen at compile time so every
+ * combination gets a parser of its own and unused checks cost nothing
+ */
+enum ParseFlag : unsigned {
+  kParseNoFlags = 0,
+  // stop after the root value, trailing data is left in the stream and tell()
+  // on any of the read streams of this library returns the root length
+  kParseStopWhenDoneFlag = 1 << 0,
+  // reject a '+' in front of an integer instead of skipping it
+  kParseNoLeadingPlusFlag = 1 << 1,
+  // also reject -0 and report leading zeros as such, implies no leading plus
+  kParseStrictFlag = 1 << 2,
+  // reject dict keys that are not in ascending byte order or are repeated
+  kParseValidateKeyOrderFlag = 1 << 3,
+  // hand out views into the buffer of streams that have nextChunk instead of
+  // copying strings and keys that fit in it
+  kParseNoCopyFlag = 1 << 4,
+  // track nested lists and dicts on an explicit stack instead of by recursion
+  kParseIterativeFlag = 1 << 5,
+  // let Document keep lists of only integers or only strings packed, read
+  // them through Value::GetIntegers() and Value::GetPackedString(index)
+  kParsePackListsFlag = 1 << 6,
+  kParseDefaultFlags = kParseNoFlags,
+  // everything a canonical document must satisfy
+  kParseCanonicalFlags = kParseStrictFlag | kParseValidateKeyOrderFlag,
+};
+
+/**
+ * @brief bounds on what a single Parse may ask of the handler, every limit is
+ * checked before the event that would allocate is delivered
+ */
+struct ParseLimits {
+  static constexpr std::size_t kUnlimited =
+      std::numeric_limits<std::size_t>::max();
+
+  // nesting of lists and dicts, the root container is depth 1
+  std::size_t max_depth_ = kUnlimited;
+  // length of a single key or string value
+  std::size_t max_string_length_ = kUnlimited;
+  // integers, strings, lists and dicts, keys are not counted
+  std::size_t max_elements_ = kUnlimited;
+  // sum of the lengths of all keys and strings
+  std::size_t max_total_bytes_ = kUnlimited;
+};
+
 class Reader : NonCopyable {
 public:
-  template <required::read_stream::HasAllRequiredFunctions ReadStream,
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
   static error::ParseError Parse(ReadStream &rs, Handler &handler);
 
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static error::ParseError Parse(ReadStream &rs, Handler &handler,
+                                 const ParseLimits &limits);
+
+  // same as Parse, but nested lists and dicts are tracked on an explicit
+  // stack instead of by recursion, so the native stack in use stays the same
+  // however deep the input is
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static error::ParseError IterativeParse(ReadStream &rs, Handler &handler);
+
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static error::ParseError IterativeParse(ReadStream &rs, Handler &handler,
+                                          const ParseLimits &limits);
+
+  // the digits of an integer between the 'i' and the 'e', with the sign rules
+  // of parseFlags, throws Exception on bad digits or overflow
+  template <unsigned parseFlags = kParseDefaultFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
+  static int64_t ScanInteger(ReadStream &rs);
+
 private:
-  template <required::read_stream::HasAllRequiredFunctions ReadStream,
+  // what is left of the limits while a parse is in progress
+  struct Budget {
+    const ParseLimits &limits_;
+    std::size_t depth_ = 0;
+    std::size_t elements_ = 0;
+    std::size_t bytes_ = 0;
+
+    void Element() {
+      if (++elements_ > limits_.max_elements_) {
+        throw Exception(error::TOO_MANY_ELEMENTS);
+      }
+    }
+
+    void Enter() {
+      if (++depth_ > limits_.max_depth_) {
+        throw Exception(error::DEPTH_LIMIT_EXCEEDED);
+      }
+    }
+
+    void Leave() { --depth_; }
+
+    void String(const std::size_t length) {
+      if (length > limits_.max_string_length_) {
+        throw Exception(error::STRING_TOO_LONG);
+      }
+      if (length > limits_.max_total_bytes_ - bytes_) {
+        throw Exception(error::TOTAL_BYTES_EXCEEDED);
+      }
+      bytes_ += length;
+    }
+  };
+
+  // the last key seen in one dict, for kParseValidateKeyOrderFlag
+  class KeyOrder {
+    std::string previous_;
+    bool first_ = true;
+
+  public:
+    void Check(const std::string_view key) {
+      if (!first_) {
+        const int cmp = key.compare(previous_);
+        if (cmp == 0) {
+          throw Exception(error::DUPLICATE_KEY);
+        }
+        if (cmp < 0) {
+          throw Exception(error::UNSORTED_KEYS);
+        }
+      }
+      previous_.assign(key);
+      first_ = false;
+    }
+  };
+
+  // the type of every list or dict the iterative parser has open, the first
+  // kInlineDepth levels are kept in place so most documents never allocate
+  class ContainerStack {
+    static constexpr std::size_t kInlineDepth = 64;
+
+    std::array<Type, kInlineDepth> inline_{};
+    std::vector<Type> spilled_;
+    std::size_t size_ = 0;
+
+  public:
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    [[nodiscard]] Type back() const {
+      return size_ <= kInlineDepth ? inline_[size_ - 1] : spilled_.back();
+    }
+
+    void push(const Type type) {
+      if (size_ < kInlineDepth) {
+        inline_[size_] = type;
+      } else {
+        spilled_.push_back(type);
+      }
+      ++size_;
+    }
+
+    void pop() {
+      if (size_ > kInlineDepth) {
+        spilled_.pop_back();
+      }
+      --size_;
+    }
+  };
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
-  static void ParseInteger(ReadStream &rs, Handler &handler);
+  static void ParseInteger(ReadStream &rs, Handler &handler, Budget &budget);
 
-  template <required::read_stream::HasAllRequiredFunctions ReadStream,
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
+  static std::size_t ParseStringLength(ReadStream &rs);
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream>
+  static decltype(auto) ReadString(ReadStream &rs, std::size_t length,
+                                   std::string &storage);
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
-  static void ParseString(ReadStream &rs, Handler &handler, bool is_key);
+  static void ParseString(ReadStream &rs, Handler &handler, Budget &budget);
 
-  template <required::read_stream::HasAllRequiredFunctions ReadStream,
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
-  static void ParseList(ReadStream &rs, Handler &handler);
+  static void ParseKey(ReadStream &rs, Handler &handler, Budget &budget,
+                       KeyOrder &order);
 
   template <required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
-  static void ParseDict(ReadStream &rs, Handler &handler);
+  static void ParseStringChunks(ReadStream &rs, Handler &handler,
+                                std::size_t length);
 
-  template <required::read_stream::HasAllRequiredFunctions ReadStream,
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static void ParseList(ReadStream &rs, Handler &handler, Budget &budget);
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static void ParseDict(ReadStream &rs, Handler &handler, Budget &budget);
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
             required::handler::HasAllRequiredFunctions Handler>
-  static void ParseValue(ReadStream &rs, Handler &handler);
+  static void ParseValue(ReadStream &rs, Handler &handler, Budget &budget);
+
+  template <unsigned parseFlags,
+            required::read_stream::HasAllRequiredFunctions ReadStream,
+            required::handler::HasAllRequiredFunctions Handler>
+  static void IterativeParseValue(ReadStream &rs, Handler &handler,
+                                  Budget &budget);
+
+  static constexpr std::size_t kStringChunkSize = 1 << 16;
+
+  // an optional sign and the 19 digits of INT64_MIN, anything longer can only
+  // overflow, so digits are not buffered past it
+  static constexpr std::size_t kMaxIntegerLength = 20;
+
+  static constexpr bool HasFlag(const unsigned parseFlags,
+                                const unsigned flag) {
+    return (parseFlags & flag) != 0;
+  }
 
   static bool IsDigit(const char ch) { return ch >= '0' && ch <= '9'; }
   static bool IsDigit1To9(const char ch) { return ch >= '1' && ch <= '9'; }
 };
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream,
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
           required::handler::HasAllRequiredFunctions Handler>
 error::ParseError Reader::Parse(ReadStream &rs, Handler &handler) {
+  return Parse<parseFlags>(rs, handler, ParseLimits{});
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+error::ParseError Reader::Parse(ReadStream &rs, Handler &handler,
+                                const ParseLimits &limits) {
   try {
-    ParseValue(rs, handler);
-    if (rs.hasNext()) {
-      throw Exception(error::ROOT_NOT_SINGULAR);
+    Budget budget{limits};
+    if constexpr (HasFlag(parseFlags, kParseIterativeFlag)) {
+      IterativeParseValue<parseFlags>(rs, handler, budget);
+    } else {
+      ParseValue<parseFlags>(rs, handler, budget);
+    }
+    if constexpr (!HasFlag(parseFlags, kParseStopWhenDoneFlag)) {
+      if (rs.hasNext()) {
+        throw Exception(error::ROOT_NOT_SINGULAR);
+      }
     }
     return error::OK;
   } catch (Exception &e) {
@@ -121,45 +349,72 @@ error::ParseError Reader::Parse(ReadStream &rs, Handler &handler) {
   }
 }
 
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+error::ParseError Reader::IterativeParse(ReadStream &rs, Handler &handler) {
+  return Parse<parseFlags | kParseIterativeFlag>(rs, handler);
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+error::ParseError Reader::IterativeParse(ReadStream &rs, Handler &handler,
+                                         const ParseLimits &limits) {
+  return Parse<parseFlags | kParseIterativeFlag>(rs, handler, limits);
+}
+
 #define CALL(expr)                                                             \
   if (!(expr))                                                                 \
   throw Exception(error::USER_STOPPED)
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream,
-          required::handler::HasAllRequiredFunctions Handler>
-void Reader::ParseInteger(ReadStream &rs, Handler &handler) {
-  if (rs.peek() == 'i') {
-    rs.next();
-  } else {
-    throw Exception(error::MISS_INITIAL_I);
-  }
-
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+int64_t Reader::ScanInteger(ReadStream &rs) {
   std::string buffer;
 
   if (rs.peek() == '+') {
+    if constexpr (HasFlag(parseFlags,
+                          kParseNoLeadingPlusFlag | kParseStrictFlag)) {
+      throw Exception(error::LEADING_PLUS);
+    }
     rs.next();
   }
   if (rs.peek() == '-') {
     buffer.push_back(rs.next());
   }
   if (rs.peek() == '0') {
+    if constexpr (HasFlag(parseFlags, kParseStrictFlag)) {
+      if (!buffer.empty()) {
+        throw Exception(error::NEGATIVE_ZERO);
+      }
+    }
     buffer.push_back(rs.next());
+    if constexpr (HasFlag(parseFlags, kParseStrictFlag)) {
+      if (IsDigit(rs.peek())) {
+        throw Exception(error::LEADING_ZERO);
+      }
+    }
   } else {
     if (!IsDigit1To9(rs.peek())) {
       throw Exception(error::BAD_VALUE);
     }
     for (buffer.push_back(rs.next()); IsDigit(rs.peek());
-         buffer.push_back(rs.next()))
-      ;
+         buffer.push_back(rs.next())) {
+      if (buffer.size() >= kMaxIntegerLength) {
+        throw Exception(error::NUMBER_TOO_BIG);
+      }
+    }
   }
 
   if (buffer.empty()) {
     throw Exception(error::BAD_VALUE);
   }
 
+  int64_t i64;
+
   try {
     std::size_t idx;
-    int64_t i64;
 #if defined(__clang__) || defined(_MSC_VER)
     i64 = std::stoll(buffer, &idx, 10);
 #elif defined(__GNUC__)
@@ -168,11 +423,29 @@ void Reader::ParseInteger(ReadStream &rs, Handler &handler) {
 #error "complier no support"
 #endif
     BENCODE_ASSERT(buffer.size() == idx);
-    CALL(handler.Integer(i64));
   } catch (...) {
     throw Exception(error::NUMBER_TOO_BIG);
   }
 
+  return i64;
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+void Reader::ParseInteger(ReadStream &rs, Handler &handler, Budget &budget) {
+  if (rs.peek() == 'i') {
+    rs.next();
+  } else {
+    throw Exception(error::MISS_INITIAL_I);
+  }
+
+  budget.Element();
+
+  const int64_t i64 = ScanInteger<parseFlags>(rs);
+
+  CALL(handler.Integer(i64));
+
   if (rs.peek() == 'e') {
     rs.next();
   } else {
@@ -180,20 +453,28 @@ void Reader::ParseInteger(ReadStream &rs, Handler &handler) {
   }
 }
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream,
-          required::handler::HasAllRequiredFunctions Handler>
-void Reader::ParseString(ReadStream &rs, Handler &handler, const bool is_key) {
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+std::size_t Reader::ParseStringLength(ReadStream &rs) {
   std::string buffer;
 
   if (rs.peek() == '0') {
     buffer.push_back(rs.next());
+    if constexpr (HasFlag(parseFlags, kParseStrictFlag)) {
+      if (IsDigit(rs.peek())) {
+        throw Exception(error::LEADING_ZERO);
+      }
+    }
   } else {
     if (!IsDigit1To9(rs.peek())) {
       throw Exception(error::MISS_STRING_LENGTH);
     }
     for (buffer.push_back(rs.next()); IsDigit(rs.peek());
-         buffer.push_back(rs.next()))
-      ;
+         buffer.push_back(rs.next())) {
+      if (buffer.size() >= kMaxIntegerLength) {
+        throw Exception(error::NUMBER_TOO_BIG);
+      }
+    }
   }
 
   if (buffer.empty()) {
@@ -222,80 +503,252 @@ void Reader::ParseString(ReadStream &rs, Handler &handler, const bool is_key) {
     throw Exception(error::MISS_COLON);
   }
 
-  if (is_key) {
-    CALL(handler.Key(rs.next(length)));
+  return static_cast<std::size_t>(length);
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream>
+decltype(auto) Reader::ReadString(ReadStream &rs, const std::size_t length,
+                                  std::string &storage) {
+  if constexpr (HasFlag(parseFlags, kParseNoCopyFlag) &&
+                required::read_stream::details::HasNextChunk<ReadStream>) {
+    // only a string that straddles the end of the buffer is copied
+    std::string_view chunk = rs.nextChunk(length);
+    if (chunk.size() == length) {
+      return chunk;
+    }
+    storage.assign(chunk);
+    storage.append(rs.next(length - chunk.size()));
+    return std::string_view(storage);
+  } else {
+    (void)storage;
+    return rs.next(length);
+  }
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+void Reader::ParseString(ReadStream &rs, Handler &handler, Budget &budget) {
+  const std::size_t length = ParseStringLength<parseFlags>(rs);
+  budget.String(length);
+
+  if constexpr (required::handler::HasStringChunks<Handler>) {
+    ParseStringChunks(rs, handler, length);
   } else {
-    CALL(handler.String(rs.next(length)));
+    std::string storage;
+    CALL(handler.String(ReadString<parseFlags>(rs, length, storage)));
   }
 }
 
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+void Reader::ParseKey(ReadStream &rs, Handler &handler, Budget &budget,
+                      KeyOrder &order) {
+  const std::size_t length = ParseStringLength<parseFlags>(rs);
+  budget.String(length);
+
+  std::string storage;
+  const auto key = ReadString<parseFlags>(rs, length, storage);
+  if constexpr (HasFlag(parseFlags, kParseValidateKeyOrderFlag)) {
+    order.Check(key);
+  } else {
+    (void)order;
+  }
+  CALL(handler.Key(key));
+}
+
 template <required::read_stream::HasAllRequiredFunctions ReadStream,
           required::handler::HasAllRequiredFunctions Handler>
-void Reader::ParseList(ReadStream &rs, Handler &handler) {
+void Reader::ParseStringChunks(ReadStream &rs, Handler &handler,
+                               std::size_t length) {
+  CALL(handler.StringStart(length));
+  while (length > 0) {
+    // the chunk is either a view into the stream buffer or an owned string
+    const auto chunk = [&rs, n = std::min(length, kStringChunkSize)] {
+      if constexpr (required::read_stream::details::HasNextChunk<ReadStream>) {
+        return rs.nextChunk(n);
+      } else {
+        return rs.next(n);
+      }
+    }();
+    if (chunk.empty()) {
+      throw Exception(error::MISS_STRING_DATA);
+    }
+    CALL(handler.StringChunk(chunk));
+    length -= chunk.size();
+  }
+  CALL(handler.StringEnd());
+}
+
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+void Reader::ParseList(ReadStream &rs, Handler &handler, Budget &budget) {
+  budget.Element();
+  budget.Enter();
   CALL(handler.StartList());
 
   rs.assertNext('l');
   if (rs.peek() == 'e') {
     rs.next();
     CALL(handler.EndList());
+    budget.Leave();
     return;
   }
 
   while (true) {
-    ParseValue(rs, handler);
+    ParseValue<parseFlags>(rs, handler, budget);
     if (rs.peek() == 'e') {
       rs.next();
       CALL(handler.EndList());
+      budget.Leave();
       return;
     }
   }
 }
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream,
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
           required::handler::HasAllRequiredFunctions Handler>
-void Reader::ParseDict(ReadStream &rs, Handler &handler) {
+void Reader::ParseDict(ReadStream &rs, Handler &handler, Budget &budget) {
+  budget.Element();
+  budget.Enter();
   CALL(handler.StartDict());
 
   rs.assertNext('d');
   if (rs.peek() == 'e') {
     rs.next();
     CALL(handler.EndDict());
+    budget.Leave();
     return;
   }
 
+  KeyOrder order;
   while (true) {
     // parse key
     if (!IsDigit(rs.peek())) {
       throw Exception(error::MISS_KEY);
     }
-    ParseString(rs, handler, true);
+    ParseKey<parseFlags>(rs, handler, budget, order);
 
     // parse element
-    ParseValue(rs, handler);
+    ParseValue<parseFlags>(rs, handler, budget);
     if (rs.peek() == 'e') {
       rs.next();
       CALL(handler.EndDict());
+      budget.Leave();
       return;
     }
   }
 }
 
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
+          required::handler::HasAllRequiredFunctions Handler>
+void Reader::IterativeParseValue(ReadStream &rs, Handler &handler,
+                                 Budget &budget) {
+  ContainerStack stack;
+  // one entry per open dict, only kept when key order is validated
+  std::vector<KeyOrder> orders;
+
+  while (true) {
+    if (!rs.hasNext()) {
+      throw Exception(error::EXPECT_VALUE);
+    }
+
+    switch (rs.peek()) {
+    case 'd':
+      budget.Element();
+      budget.Enter();
+      CALL(handler.StartDict());
+      rs.next();
+      stack.push(B_DICT);
+      if constexpr (HasFlag(parseFlags, kParseValidateKeyOrderFlag)) {
+        orders.emplace_back();
+      }
+      break;
+    case 'i':
+      ParseInteger<parseFlags>(rs, handler, budget);
+      break;
+    case 'l':
+      budget.Element();
+      budget.Enter();
+      CALL(handler.StartList());
+      rs.next();
+      stack.push(B_LIST);
+      break;
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      budget.Element();
+      ParseString<parseFlags>(rs, handler, budget);
+      break;
+    default:
+      throw Exception(error::BAD_VALUE);
+    }
+
+    // close every container that ends here, then move on to the next value,
+    // reading its key first when it is a dict member
+    while (true) {
+      if (stack.empty()) {
+        return;
+      }
+      if (rs.peek() == 'e') {
+        rs.next();
+        if (stack.back() == B_LIST) {
+          CALL(handler.EndList());
+        } else {
+          CALL(handler.EndDict());
+          if constexpr (HasFlag(parseFlags, kParseValidateKeyOrderFlag)) {
+            orders.pop_back();
+          }
+        }
+        budget.Leave();
+        stack.pop();
+        continue;
+      }
+      if (stack.back() == B_DICT) {
+        if (!IsDigit(rs.peek())) {
+          throw Exception(error::MISS_KEY);
+        }
+        if constexpr (HasFlag(parseFlags, kParseValidateKeyOrderFlag)) {
+          ParseKey<parseFlags>(rs, handler, budget, orders.back());
+        } else {
+          KeyOrder unused;
+          ParseKey<parseFlags>(rs, handler, budget, unused);
+        }
+      }
+      break;
+    }
+  }
+}
+
 #undef CALL
 
-template <required::read_stream::HasAllRequiredFunctions ReadStream,
+template <unsigned parseFlags,
+          required::read_stream::HasAllRequiredFunctions ReadStream,
           required::handler::HasAllRequiredFunctions Handler>
-void Reader::ParseValue(ReadStream &rs, Handler &handler) {
+void Reader::ParseValue(ReadStream &rs, Handler &handler, Budget &budget) {
   if (!rs.hasNext()) {
     throw Exception(error::EXPECT_VALUE);
   }
 
   switch (rs.peek()) {
   case 'd':
-    return ParseDict(rs, handler);
+    return ParseDict<parseFlags>(rs, handler, budget);
   case 'i':
-    return ParseInteger(rs, handler);
+    return ParseInteger<parseFlags>(rs, handler, budget);
   case 'l':
-    return ParseList(rs, handler);
+    return ParseList<parseFlags>(rs, handler, budget);
   case '0':
   case '1':
   case '2':
@@ -306,12 +759,36 @@ void Reader::ParseValue(ReadStream &rs, Handler &handler) {
   case '7':
   case '8':
   case '9':
-    return ParseString(rs, handler, false);
+    budget.Element();
+    return ParseString<parseFlags>(rs, handler, budget);
   default:
     throw Exception(error::BAD_VALUE);
   }
 }
 
+namespace internal {
+
+template <required::handler::HasAllRequiredFunctions Handler>
+bool ReplayRaw(const std::string_view bencode, Handler &handler) {
+  StringReadStream rs(bencode);
+  return Reader::Parse(rs, handler) == error::OK;
+}
+
+/**
+ * @brief hands pre-encoded bencode to the handler, verbatim if it supports
+ * RawValue, replayed as events otherwise
+ */
+template <required::handler::HasAllRequiredFunctions Handler>
+bool WriteRaw(const std::string_view bencode, Handler &handler) {
+  if constexpr (required::handler::HasRawValue<Handler>) {
+    return handler.RawValue(bencode);
+  } else {
+    return ReplayRaw(bencode, handler);
+  }
+}
+
+} // namespace internal
+
 } // namespace bencode
 
 #endif // BENCODE_INCLUDE_BENCODE_READER_H_
@@ -27,6 +27,7 @@
 #ifndef BENCODE_INCLUDE_BENCODE_STRING_READ_STREAM_H_
 #define BENCODE_INCLUDE_BENCODE_STRING_READ_STREAM_H_
 
+#include <algorithm>
 #include <string_view>
 
 #include "bencode.h"
@@ -50,6 +51,12 @@ public:
 
   [[nodiscard]] char peek() const { return hasNext() ? *iter_ : '\0'; }
 
+  // bytes consumed so far, after a parse with kParseStopWhenDoneFlag this is
+  // the length of the root value
+  [[nodiscard]] std::size_t tell() const {
+    return static_cast<std::size_t>(std::distance(bencode_.begin(), iter_));
+  }
+
   char next() {
     if (hasNext()) {
       const char ch = *iter_;
@@ -67,6 +74,11 @@ public:
     return {start, iter_};
   }
 
+  std::string_view nextChunk(const std::size_t n) {
+    return next(std::min(
+        n, static_cast<std::size_t>(std::distance(iter_, bencode_.end()))));
+  }
+
   void skip(const std::size_t n) {
     if (static_cast<std::size_t>(std::distance(iter_, bencode_.end())) >= n) {
       std::advance(iter_, n);
@@ -31,10 +31,16 @@
 #include <cstring>
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
@@ -92,6 +98,37 @@ concept HasAllRequiredFunctions =
     details::HasNull<T> && details::HasInteger<T> && details::HasString<T> &&
     details::HasKey<T> && details::HasStartList<T> && details::HasEndList<T> &&
     details::HasStartDict<T> && details::HasEndDict<T>;
+
+/**
+ * @brief optional extension, pre-encoded bencode is copied verbatim instead of
+ * being replayed event by event
+ */
+template <typename T>
+concept HasRawValue = requires(T handler, std::string_view sv) {
+  { handler.RawValue(sv) } -> std::same_as<bool>;
+};
+
+/**
+ * @brief optional extension, runs of integer list elements are delivered in one
+ * call
+ */
+template <typename T>
+concept HasIntegers = requires(T handler, std::span<const int64_t> values) {
+  { handler.Integers(values) } -> std::same_as<bool>;
+};
+
+/**
+ * @brief optional extension, string values are delivered in bounded chunks
+ * instead of a single String() call
+ */
+template <typename T>
+concept HasStringChunks = requires(T handler, std::size_t n,
+                                   std::string_view sv) {
+  { handler.StringStart(n) } -> std::same_as<bool>;
+  { handler.StringChunk(sv) } -> std::same_as<bool>;
+  { handler.StringEnd() } -> std::same_as<bool>;
+};
+
 } // namespace required::handler
 
 #undef VALUE
@@ -99,10 +136,13 @@ concept HasAllRequiredFunctions =
   field(NULL, std::monostate) suffix field(INTEGER, int64_t)                   \
   suffix field(STRING, std::shared_ptr<std::string>)                           \
       suffix field(LIST, std::shared_ptr<std::vector<Value>>)                  \
-          suffix field(DICT, std::shared_ptr<std::vector<Member>>) //
+          suffix field(DICT, std::shared_ptr<std::vector<Member>>)           \
+              suffix field(RAW, std::shared_ptr<Raw>) //
 
 class Value;
 struct Member;
+struct Raw;
+struct PackedList;
 
 enum Type {
 #undef VALUE_NAME
@@ -122,10 +162,34 @@ using Data = std::variant<
     VALUE(VALUE_TYPE, SUFFIX)
 #undef SUFFIX
 #undef VALUE_TYPE
-    >;
+    ,
+    // a list of type B_LIST kept packed, see kParsePackListsFlag
+    std::shared_ptr<PackedList>>;
 
 class Document;
 
+/**
+ * @brief heap bytes held by a tree, see Value::MemoryUsage()
+ */
+struct MemoryFootprint {
+  // Value slots of list and dict buffers, and the string and vector objects
+  // kept in the shared blocks
+  std::size_t node_bytes_ = 0;
+  // out-of-line buffers of keys and of string and raw values, short strings
+  // stored inline add nothing here
+  std::size_t key_bytes_ = 0;
+  std::size_t string_bytes_ = 0;
+  // reserved but unused capacity of list and dict buffers
+  std::size_t slack_bytes_ = 0;
+  // reference counts in front of every shared string, list, dict and raw value
+  std::size_t control_block_bytes_ = 0;
+
+  [[nodiscard]] std::size_t total() const {
+    return node_bytes_ + key_bytes_ + string_bytes_ + slack_bytes_ +
+           control_block_bytes_;
+  }
+};
+
 class Value {
 public:
   using MemberIterator = std::vector<Member>::iterator;
@@ -160,13 +224,20 @@ public:
   Value(const Value &value) = default;
   Value(Value &&value) noexcept
       : type_(value.type_), data_(std::move(value.data_)) {}
-  ~Value() = default;
+  ~Value();
 
   [[nodiscard]] bool IsNull() const { return type_ == B_NULL; }
   [[nodiscard]] bool IsInteger() const { return type_ == B_INTEGER; }
   [[nodiscard]] bool IsString() const { return type_ == B_STRING; }
   [[nodiscard]] bool IsList() const { return type_ == B_LIST; }
   [[nodiscard]] bool IsDict() const { return type_ == B_DICT; }
+  [[nodiscard]] bool IsRaw() const { return type_ == B_RAW; }
+  // a list parsed with kParsePackListsFlag that holds only integers or only
+  // strings, GetList() and operator[] build its elements as values on first
+  // use, which stay read-only until Unpack()
+  [[nodiscard]] bool IsPacked() const {
+    return std::holds_alternative<std::shared_ptr<PackedList>>(data_);
+  }
 
   [[nodiscard]] std::size_t GetSize() const;
   [[nodiscard]] Type GetType() const;
@@ -175,11 +246,20 @@ public:
   [[nodiscard]] std::string GetString() const;
   [[nodiscard]] const auto &GetList() const;
   [[nodiscard]] const auto &GetDict() const;
+  [[nodiscard]] std::string_view GetRaw() const;
+
+  // elements of a packed list, B_INTEGER or B_STRING
+  [[nodiscard]] Type GetPackedType() const;
+  [[nodiscard]] std::span<const int64_t> GetIntegers() const;
+  [[nodiscard]] std::string_view GetPackedString(std::size_t index) const;
 
   Value &SetInteger(B_INTEGER_TYPE i);
   Value &SetString(std::string_view sv);
   Value &SetList();
   Value &SetDict();
+  Value &SetRaw(std::string_view bencode);
+  // turns a packed list into a list of values, other values are left as is
+  Value &Unpack();
 
   MemberIterator MemberBegin();
   MemberIterator MemberEnd();
@@ -203,6 +283,29 @@ public:
 
   template <required::handler::HasAllRequiredFunctions Handler>
   bool WriteTo(Handler &handler) const;
+
+  /**
+   * @brief bytes held on the heap by this value and everything below it, a
+   * subtree shared by several values through copy assignment is counted once
+   */
+  [[nodiscard]] MemoryFootprint MemoryUsage() const;
+
+private:
+  // shares str, which is never modified afterwards
+  explicit Value(B_STRING_TYPE str) : type_(B_STRING), data_(std::move(str)) {}
+
+  template <required::handler::HasAllRequiredFunctions Handler>
+  bool WriteElementsTo(Handler &handler) const;
+  template <required::handler::HasAllRequiredFunctions Handler>
+  bool WritePackedTo(Handler &handler) const;
+
+  [[nodiscard]] const PackedList &Packed() const;
+
+  void TakeNested(std::vector<Value> &nested);
+
+  void AccountMemory(MemoryFootprint &usage,
+                     std::unordered_set<const void *> &seen,
+                     bool is_key) const;
 };
 
 #undef VALUE
@@ -217,6 +320,64 @@ struct Member {
   Value value_;
 };
 
+/**
+ * @brief pre-encoded bencode, trusted to hold exactly one valid value
+ */
+struct Raw {
+  std::string bencode_;
+};
+
+/**
+ * @brief elements of a list that held only integers or only strings, one
+ * int64_t array or one byte blob plus the end offset of every string
+ */
+struct PackedList {
+  explicit PackedList(const Type type) : type_(type) {}
+
+  [[nodiscard]] std::size_t size() const {
+    return type_ == B_INTEGER ? integers_.size() : ends_.size();
+  }
+
+  [[nodiscard]] std::string_view String(const std::size_t index) const {
+    BENCODE_ASSERT(type_ == B_STRING);
+    BENCODE_ASSERT(index < ends_.size());
+    const std::size_t begin = index == 0 ? 0 : ends_[index - 1];
+    return std::string_view(bytes_).substr(begin, ends_[index] - begin);
+  }
+
+  // a fresh list of values holding the elements
+  [[nodiscard]] std::shared_ptr<std::vector<Value>> MakeList() const {
+    auto list = std::make_shared<std::vector<Value>>();
+    list->reserve(size());
+    for (std::size_t i = 0; i < size(); ++i) {
+      if (type_ == B_INTEGER) {
+        list->emplace_back(integers_[i]);
+      } else {
+        list->emplace_back(String(i));
+      }
+    }
+    return list;
+  }
+
+  // the elements as values, built once and shared by every copy
+  [[nodiscard]] const std::shared_ptr<std::vector<Value>> &Elements() const {
+    std::call_once(elements_once_, [this] {
+      elements_ = MakeList();
+      built_.store(true, std::memory_order_release);
+    });
+    return elements_;
+  }
+
+  Type type_;
+  std::vector<int64_t> integers_;
+  std::string bytes_;
+  std::vector<std::size_t> ends_;
+
+  mutable std::once_flag elements_once_;
+  mutable std::shared_ptr<std::vector<Value>> elements_;
+  mutable std::atomic<bool> built_ = false;
+};
+
 inline Value::Value(const Type type) : type_(type) {
   switch (type) {
   case B_NULL:
@@ -231,14 +392,53 @@ inline Value::Value(const Type type) : type_(type) {
   case B_DICT:
     data_ = std::make_shared<Dict>();
     break;
+  case B_RAW:
+    data_ = std::make_shared<Raw>();
+    break;
   default:
     BENCODE_ASSERT(false && "bad value GetType");
   }
 }
 
+// nested lists and dicts are freed from a local stack rather than by the
+// destructors of their elements, so a deep value cannot overflow the stack
+inline Value::~Value() {
+  std::vector<Value> nested;
+  TakeNested(nested);
+  while (!nested.empty()) {
+    Value value = std::move(nested.back());
+    nested.pop_back();
+    value.TakeNested(nested);
+  }
+}
+
+// moves the lists and dicts held by a list or dict that is not shared into
+// nested, leaving only leaves to be freed with it
+inline void Value::TakeNested(std::vector<Value> &nested) {
+  const auto take = [&nested](Value &value) {
+    const auto *list = std::get_if<B_LIST_TYPE>(&value.data_);
+    const auto *dict = std::get_if<B_DICT_TYPE>(&value.data_);
+    if ((list != nullptr && *list != nullptr) ||
+        (dict != nullptr && *dict != nullptr)) {
+      nested.push_back(std::move(value));
+    }
+  };
+  if (auto *list = std::get_if<B_LIST_TYPE>(&data_);
+      list != nullptr && list->use_count() == 1) {
+    std::ranges::for_each(**list, take);
+  } else if (auto *dict = std::get_if<B_DICT_TYPE>(&data_);
+             dict != nullptr && dict->use_count() == 1) {
+    std::ranges::for_each(**dict,
+                          [&take](Member &member) { take(member.value_); });
+  }
+}
+
 inline std::size_t Value::GetSize() const {
   switch (type_) {
   case B_LIST:
+    if (IsPacked()) {
+      return Packed().size();
+    }
     return std::get<B_LIST_TYPE>(data_)->size();
   case B_DICT:
     return std::get<B_DICT_TYPE>(data_)->size();
@@ -267,6 +467,9 @@ inline std::string Value::GetString() const {
 
 inline const auto &Value::GetList() const {
   BENCODE_ASSERT(type_ == B_LIST);
+  if (IsPacked()) {
+    return Packed().Elements();
+  }
   return std::get<B_LIST_TYPE>(data_);
 }
 
@@ -275,6 +478,28 @@ inline const auto &Value::GetDict() const {
   return std::get<B_DICT_TYPE>(data_);
 }
 
+inline std::string_view Value::GetRaw() const {
+  BENCODE_ASSERT(type_ == B_RAW);
+  return std::get<B_RAW_TYPE>(data_)->bencode_;
+}
+
+inline const PackedList &Value::Packed() const {
+  BENCODE_ASSERT(IsPacked());
+  return *std::get<std::shared_ptr<PackedList>>(data_);
+}
+
+inline Type Value::GetPackedType() const { return Packed().type_; }
+
+inline std::span<const int64_t> Value::GetIntegers() const {
+  BENCODE_ASSERT(GetPackedType() == B_INTEGER);
+  return Packed().integers_;
+}
+
+inline std::string_view
+Value::GetPackedString(const std::size_t index) const {
+  return Packed().String(index);
+}
+
 inline Value &Value::SetInteger(const B_INTEGER_TYPE i) {
   this->~Value();
   return *new (this) Value(i);
@@ -295,6 +520,13 @@ inline Value &Value::SetDict() {
   return *new (this) Value(B_DICT);
 }
 
+inline Value &Value::SetRaw(const std::string_view bencode) {
+  this->~Value();
+  new (this) Value(B_RAW);
+  std::get<B_RAW_TYPE>(data_)->bencode_.assign(bencode);
+  return *this;
+}
+
 inline Value::MemberIterator Value::MemberBegin() {
   BENCODE_ASSERT(type_ == B_DICT);
   return std::get<B_DICT_TYPE>(data_)->begin();
@@ -309,7 +541,11 @@ inline Value::MemberIterator Value::FindMember(const std::string_view key) {
   BENCODE_ASSERT(type_ == B_DICT);
   return std::ranges::find_if(*std::get<B_DICT_TYPE>(data_),
                               [key](const Member &member) -> bool {
-                                return member.key_.GetStringView() == key;
+                                // interned keys match on the pointer alone
+                                const auto str = member.key_.GetStringView();
+                                return str.data() == key.data()
+                                           ? str.size() == key.size()
+                                           : str == key;
                               });
 }
 
@@ -345,7 +581,7 @@ inline Value &Value::operator=(Value &&val) noexcept {
 
 inline Value &Value::operator[](const std::size_t index) {
   BENCODE_ASSERT(type_ == B_LIST);
-  return std::get<B_LIST_TYPE>(data_)->at(index);
+  return GetList()->at(index);
 }
 
 inline const Value &Value::operator[](const std::size_t index) const {
@@ -370,6 +606,7 @@ inline const Value &Value::operator[](const std::string_view key) const {
 
 template <typename T> Value &Value::AddValue(T &&value) {
   BENCODE_ASSERT(type_ == B_LIST);
+  Unpack();
   auto ptr = std::get<B_LIST_TYPE>(data_);
   ptr->emplace_back(std::forward<T>(value));
   return ptr->back();
@@ -379,6 +616,15 @@ template <typename T> Value &Value::AddMember(const char *key, T &&value) {
   return AddMember(Value(key), Value(std::forward<T>(value)));
 }
 
+inline Value &Value::Unpack() {
+  if (!IsPacked()) {
+    return *this;
+  }
+  // the packed elements may be shared with copies, they are left untouched
+  data_ = Packed().MakeList();
+  return *this;
+}
+
 inline Value &Value::AddMember(Value &&key, Value &&value) {
   BENCODE_ASSERT(type_ == B_DICT);
   BENCODE_ASSERT(key.type_ == B_STRING);
@@ -388,6 +634,106 @@ inline Value &Value::AddMember(Value &&key, Value &&value) {
   return ptr->back().value_;
 }
 
+namespace internal {
+
+/**
+ * @brief replays pre-encoded bencode as events to a handler without RawValue,
+ * defined in reader.h as it needs the complete Reader
+ */
+template <required::handler::HasAllRequiredFunctions Handler>
+bool ReplayRaw(std::string_view bencode, Handler &handler);
+
+// make_shared places a vtable pointer and two 32-bit reference counts in front
+// of the object on the common ABIs
+constexpr std::size_t kSharedControlBlockSize = 2 * sizeof(void *);
+
+inline std::size_t HeapBytes(const std::string &str) {
+  const auto *self = reinterpret_cast<const char *>(&str);
+  const std::less<const char *> less;
+  if (!less(str.data(), self) && less(str.data(), self + sizeof(str))) {
+    return 0;
+  }
+  return str.capacity() + 1;
+}
+
+} // namespace internal
+
+inline MemoryFootprint Value::MemoryUsage() const {
+  MemoryFootprint usage;
+  std::unordered_set<const void *> seen;
+  AccountMemory(usage, seen, false);
+  return usage;
+}
+
+inline void Value::AccountMemory(MemoryFootprint &usage,
+                                 std::unordered_set<const void *> &seen,
+                                 const bool is_key) const {
+  const auto first_seen = [&usage, &seen](const auto &ptr) {
+    if (ptr == nullptr || !seen.insert(ptr.get()).second) {
+      return false;
+    }
+    usage.node_bytes_ += sizeof(*ptr);
+    usage.control_block_bytes_ += internal::kSharedControlBlockSize;
+    return true;
+  };
+
+  switch (type_) {
+  case B_STRING:
+    if (const auto &ptr = std::get<B_STRING_TYPE>(data_); first_seen(ptr)) {
+      (is_key ? usage.key_bytes_ : usage.string_bytes_) +=
+          internal::HeapBytes(*ptr);
+    }
+    break;
+  case B_LIST:
+    if (IsPacked()) {
+      if (const auto &ptr = std::get<std::shared_ptr<PackedList>>(data_);
+          first_seen(ptr)) {
+        const auto slots = [&usage](const auto &vec) {
+          using T = typename std::decay_t<decltype(vec)>::value_type;
+          usage.node_bytes_ += vec.size() * sizeof(T);
+          usage.slack_bytes_ += (vec.capacity() - vec.size()) * sizeof(T);
+        };
+        slots(ptr->integers_);
+        slots(ptr->ends_);
+        usage.string_bytes_ += internal::HeapBytes(ptr->bytes_);
+        if (ptr->built_.load(std::memory_order_acquire)) {
+          const auto &elements = *ptr->elements_;
+          usage.control_block_bytes_ += internal::kSharedControlBlockSize;
+          slots(elements);
+          for (const auto &val : elements) {
+            val.AccountMemory(usage, seen, false);
+          }
+        }
+      }
+    } else if (const auto &ptr = std::get<B_LIST_TYPE>(data_);
+               first_seen(ptr)) {
+      usage.node_bytes_ += ptr->size() * sizeof(Value);
+      usage.slack_bytes_ += (ptr->capacity() - ptr->size()) * sizeof(Value);
+      for (const auto &val : *ptr) {
+        val.AccountMemory(usage, seen, false);
+      }
+    }
+    break;
+  case B_DICT:
+    if (const auto &ptr = std::get<B_DICT_TYPE>(data_); first_seen(ptr)) {
+      usage.node_bytes_ += ptr->size() * sizeof(Member);
+      usage.slack_bytes_ += (ptr->capacity() - ptr->size()) * sizeof(Member);
+      for (const auto &member : *ptr) {
+        member.key_.AccountMemory(usage, seen, true);
+        member.value_.AccountMemory(usage, seen, false);
+      }
+    }
+    break;
+  case B_RAW:
+    if (const auto &ptr = std::get<B_RAW_TYPE>(data_); first_seen(ptr)) {
+      usage.string_bytes_ += internal::HeapBytes(ptr->bencode_);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
 #define CALL_HANDLER(expr)                                                     \
   do {                                                                         \
     if (!(expr)) {                                                             \
@@ -409,8 +755,10 @@ bool Value::WriteTo(Handler &handler) const {
     break;
   case B_LIST:
     CALL_HANDLER(handler.StartList());
-    for (auto &val : *GetList()) {
-      CALL_HANDLER(val.WriteTo(handler));
+    if (IsPacked()) {
+      CALL_HANDLER(WritePackedTo(handler));
+    } else {
+      CALL_HANDLER(WriteElementsTo(handler));
     }
     CALL_HANDLER(handler.EndList());
     break;
@@ -422,12 +770,71 @@ bool Value::WriteTo(Handler &handler) const {
     }
     CALL_HANDLER(handler.EndDict());
     break;
+  case B_RAW:
+    if constexpr (required::handler::HasRawValue<Handler>) {
+      CALL_HANDLER(handler.RawValue(GetRaw()));
+    } else {
+      CALL_HANDLER(internal::ReplayRaw(GetRaw(), handler));
+    }
+    break;
   default:
     BENCODE_ASSERT(false && "bad type");
   }
   return true;
 }
 
+template <required::handler::HasAllRequiredFunctions Handler>
+bool Value::WriteElementsTo(Handler &handler) const {
+  if constexpr (required::handler::HasIntegers<Handler>) {
+    // gather runs of integers so they are encoded as a batch
+    constexpr std::size_t kBatchSize = 64;
+    int64_t batch[kBatchSize];
+    std::size_t size = 0;
+    const auto flush = [&handler, &batch, &size] {
+      const bool ret =
+          size == 0 || handler.Integers(std::span<const int64_t>(batch, size));
+      size = 0;
+      return ret;
+    };
+
+    for (auto &val : *GetList()) {
+      if (val.type_ != B_INTEGER) {
+        CALL_HANDLER(flush());
+        CALL_HANDLER(val.WriteTo(handler));
+        continue;
+      }
+      batch[size++] = std::get<B_INTEGER_TYPE>(val.data_);
+      if (size == kBatchSize) {
+        CALL_HANDLER(flush());
+      }
+    }
+    CALL_HANDLER(flush());
+  } else {
+    for (auto &val : *GetList()) {
+      CALL_HANDLER(val.WriteTo(handler));
+    }
+  }
+  return true;
+}
+
+template <required::handler::HasAllRequiredFunctions Handler>
+bool Value::WritePackedTo(Handler &handler) const {
+  const auto &packed = Packed();
+  if (packed.type_ == B_STRING) {
+    for (std::size_t i = 0; i < packed.size(); ++i) {
+      CALL_HANDLER(handler.String(GetPackedString(i)));
+    }
+  } else if constexpr (required::handler::HasIntegers<Handler>) {
+    CALL_HANDLER(packed.integers_.empty() ||
+                 handler.Integers(std::span<const int64_t>(packed.integers_)));
+  } else {
+    for (const int64_t i64 : packed.integers_) {
+      CALL_HANDLER(handler.Integer(i64));
+    }
+  }
+  return true;
+}
+
 #undef CALL_HANDLER
 
 } // namespace bencode
@@ -29,6 +29,8 @@
 
 #include <cstdint>
 
+#include <algorithm>
+#include <span>
 #include <string_view>
 #include <vector>
 
@@ -85,12 +87,22 @@ public:
   virtual bool Integer(const int64_t i64) {
     return EndValue(WriteInteger(i64));
   }
+  // hands every integer to Integer(), so a subclass that only overrides
+  // Integer() still sees list elements, BatchWriter encodes them at once
+  virtual bool Integers(const std::span<const int64_t> values) {
+    return std::ranges::all_of(
+        values, [this](const int64_t i64) { return Integer(i64); });
+  }
   virtual bool String(const std::string_view str) {
     return EndValue(WriteString(str));
   }
   virtual bool Key(const std::string_view str) {
     return EndValue(WriteKey(str));
   }
+  virtual bool RawValue(const std::string_view bencode) {
+    os_.puts(bencode.data(), bencode.size());
+    return EndValue(true);
+  }
   virtual bool StartList() {
     ++stack_;
     return EndValue(WriteStartList());
@@ -110,7 +122,9 @@ public:
 
 protected:
   bool WriteInteger(int64_t i64);
+  bool WriteIntegers(std::span<const int64_t> values);
   bool WriteString(std::string_view str);
+  bool WriteStringLength(std::size_t length);
   bool WriteKey(std::string_view str);
   bool WriteStartList();
   bool WriteEndList();
@@ -120,24 +134,73 @@ protected:
   void Flush() { os_.flush(); }
 };
 
+/**
+ * @brief writer that also takes strings in chunks, so the reader copies long
+ * strings straight through instead of staging them; those strings never reach
+ * String()
+ */
+template <required::write_stream::HasAllRequiredFunctions WriteStream>
+class ChunkedWriter : public Writer<WriteStream> {
+public:
+  explicit ChunkedWriter(WriteStream &os) : Writer<WriteStream>(os) {}
+
+  virtual bool StringStart(const std::size_t length) {
+    return this->WriteStringLength(length);
+  }
+  virtual bool StringChunk(const std::string_view str) {
+    this->os_.puts(str.data(), str.size());
+    return true;
+  }
+  virtual bool StringEnd() { return this->EndValue(true); }
+};
+
+/**
+ * @brief writer that encodes runs of integer list elements as one batch; those
+ * integers never reach Integer()
+ */
+template <required::write_stream::HasAllRequiredFunctions WriteStream>
+class BatchWriter : public Writer<WriteStream> {
+public:
+  explicit BatchWriter(WriteStream &os) : Writer<WriteStream>(os) {}
+
+  bool Integers(const std::span<const int64_t> values) override {
+    return this->EndValue(this->WriteIntegers(values));
+  }
+};
+
 template <required::write_stream::HasAllRequiredFunctions WriteStream>
 bool Writer<WriteStream>::WriteInteger(const int64_t i64) {
-  char buf[32]{};
-  auto size = static_cast<std::size_t>(internal::i64toa(i64, buf) - buf);
-  os_.put('i');
-  os_.puts(buf, size);
-  os_.put('e');
+  char buf[internal::kMaxEncodedIntegerSize];
+  const char *end = internal::i64toa_list(std::span(&i64, 1), buf);
+  os_.puts(buf, static_cast<std::size_t>(end - buf));
+  return true;
+}
+
+template <required::write_stream::HasAllRequiredFunctions WriteStream>
+bool Writer<WriteStream>::WriteIntegers(const std::span<const int64_t> values) {
+  constexpr std::size_t kBatchSize = 64;
+  char buf[kBatchSize * internal::kMaxEncodedIntegerSize];
+  for (std::size_t i = 0; i < values.size(); i += kBatchSize) {
+    const char *end = internal::i64toa_list(
+        values.subspan(i, std::min(kBatchSize, values.size() - i)), buf);
+    os_.puts(buf, static_cast<std::size_t>(end - buf));
+  }
   return true;
 }
 
 template <required::write_stream::HasAllRequiredFunctions WriteStream>
 bool Writer<WriteStream>::WriteString(const std::string_view str) {
-  char buf[32]{};
-  auto size =
-      static_cast<std::size_t>(internal::u64toa(str.length(), buf) - buf);
+  WriteStringLength(str.length());
+  os_.puts(str.data(), str.size());
+  return true;
+}
+
+template <required::write_stream::HasAllRequiredFunctions WriteStream>
+bool Writer<WriteStream>::WriteStringLength(const std::size_t length) {
+  char buf[internal::kItoaBufferSize]{};
+  auto size = static_cast<std::size_t>(internal::u64toa(length, buf) - buf);
   os_.puts(buf, size);
   os_.put(':');
-  os_.puts(str.data(), str.size());
   return true;
 }
 
@@ -0,0 +1,273 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bencode/binding.h"
+#include "bencode/canonical.h"
+#include "bencode/exception.h"
+#include "bencode/file_read_stream.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+#include "temp_file.h"
+
+#if defined(__GNUC__)
+BENCODE_DIAG_PUSH
+BENCODE_DIAG_OFF(effc++)
+#endif
+
+struct File {
+  int64_t length_{};
+  std::vector<std::string> path_;
+};
+
+struct Info {
+  std::vector<File> files_;
+  std::string name_;
+  int32_t piece_length_{};
+  std::string pieces_;
+  std::optional<int64_t> private_;
+};
+
+struct Torrent {
+  std::string announce_;
+  std::optional<std::string> comment_;
+  uint64_t creation_date_{};
+  Info info_;
+};
+
+template <> struct bencode::FieldMap<File> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("length", &File::length_),
+                      Field("path", &File::path_));
+};
+
+template <> struct bencode::FieldMap<Info> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("files", &Info::files_),
+                      Field("name", &Info::name_),
+                      Field("piece length", &Info::piece_length_),
+                      Field("pieces", &Info::pieces_),
+                      Field("private", &Info::private_));
+};
+
+template <> struct bencode::FieldMap<Torrent> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("announce", &Torrent::announce_),
+                      Field("comment", &Torrent::comment_),
+                      Field("creation date", &Torrent::creation_date_),
+                      Field("info", &Torrent::info_));
+};
+
+// a KRPC reply, the fields are declared out of key order on purpose
+struct Reply {
+  struct Values {
+    std::string id_;
+    std::vector<int64_t> ports_;
+  };
+
+  std::string y_ = "r";
+  std::string t_;
+  Values r_;
+  std::optional<std::string> v_;
+};
+
+template <> struct bencode::FieldMap<Reply::Values> {
+  static constexpr auto kFields =
+      std::make_tuple(Field("ports", &Reply::Values::ports_),
+                      Field("id", &Reply::Values::id_));
+};
+
+template <> struct bencode::FieldMap<Reply> {
+  static constexpr auto kFields = std::make_tuple(
+      Field("y", &Reply::y_), Field("v", &Reply::v_), Field("t", &Reply::t_),
+      Field("r", &Reply::r_));
+};
+
+template <typename T> static std::string Encode(const T &value) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  EXPECT_TRUE(bencode::WriteTo(value, writer));
+  return std::string(os.get());
+}
+
+#define ERROR_EQ(expect, actual)                                               \
+  do {                                                                         \
+    EXPECT_STREQ(bencode::ParseErrorStr((expect)),                             \
+                 bencode::ParseErrorStr((actual)));                            \
+  } while (0) //
+
+constexpr std::string_view kTorrent =
+    "d8:announce16:http://tracker/a10:created by6:mktorr13:creation date"
+    "i1671279452e4:infod5:filesld6:lengthi12e4:pathl5:a.txteed6:lengthi7e"
+    "4:pathl3:dir5:b.txteee4:name4:test12:piece lengthi16384e"
+    "6:pieces20:01234567890123456789e8:url-listl12:http://seed/d1:xli1eeeee";
+
+TEST(binding, perfect_hash) {
+  constexpr bencode::internal::binding::PerfectHash<3> hash(
+      {"length", "name", "piece length"});
+  static_assert(hash.Find("length") == 0);
+  static_assert(hash.Find("name") == 1);
+  static_assert(hash.Find("piece length") == 2);
+  static_assert(hash.Find("pieces") == 3);
+  static_assert(hash.Find("") == 3);
+}
+
+TEST(binding, torrent) {
+  Torrent torrent;
+  ERROR_EQ(bencode::error::OK, bencode::ParseInto(kTorrent, torrent));
+
+  EXPECT_EQ("http://tracker/a", torrent.announce_);
+  EXPECT_FALSE(torrent.comment_.has_value());
+  EXPECT_EQ(1671279452U, torrent.creation_date_);
+  EXPECT_EQ("test", torrent.info_.name_);
+  EXPECT_EQ(16384, torrent.info_.piece_length_);
+  EXPECT_EQ("01234567890123456789", torrent.info_.pieces_);
+  EXPECT_FALSE(torrent.info_.private_.has_value());
+
+  ASSERT_EQ(2UL, torrent.info_.files_.size());
+  EXPECT_EQ(12, torrent.info_.files_[0].length_);
+  EXPECT_EQ(std::vector<std::string>{"a.txt"}, torrent.info_.files_[0].path_);
+  EXPECT_EQ(7, torrent.info_.files_[1].length_);
+  EXPECT_EQ((std::vector<std::string>{"dir", "b.txt"}),
+            torrent.info_.files_[1].path_);
+}
+
+TEST(binding, optional) {
+  Info info;
+  ERROR_EQ(bencode::error::OK,
+           bencode::ParseInto("d4:name1:a7:privatei1ee", info));
+  EXPECT_EQ("a", info.name_);
+  ASSERT_TRUE(info.private_.has_value());
+  EXPECT_EQ(1, *info.private_);
+}
+
+TEST(binding, non_struct_root) {
+  std::vector<int64_t> integers;
+  ERROR_EQ(bencode::error::OK, bencode::ParseInto("li1ei-2ei3ee", integers));
+  EXPECT_EQ((std::vector<int64_t>{1, -2, 3}), integers);
+
+  std::vector<std::vector<std::string>> nested;
+  ERROR_EQ(bencode::error::OK, bencode::ParseInto("ll1:ael1:b1:cee", nested));
+  ASSERT_EQ(2UL, nested.size());
+  EXPECT_EQ((std::vector<std::string>{"b", "c"}), nested[1]);
+}
+
+TEST(binding, errors) {
+  Torrent torrent;
+  ERROR_EQ(bencode::error::TYPE_MISMATCH,
+           bencode::ParseInto("d8:announcei1ee", torrent));
+  ERROR_EQ(bencode::error::TYPE_MISMATCH,
+           bencode::ParseInto("d4:infoleee", torrent));
+  ERROR_EQ(bencode::error::TYPE_MISMATCH, bencode::ParseInto("le", torrent));
+  ERROR_EQ(bencode::error::NUMBER_TOO_BIG,
+           bencode::ParseInto("d13:creation datei-1ee", torrent));
+  // piece length is an int32_t
+  ERROR_EQ(
+      bencode::error::NUMBER_TOO_BIG,
+      bencode::ParseInto("d4:infod12:piece lengthi4294967296eee", torrent));
+  ERROR_EQ(bencode::error::MISS_KEY, bencode::ParseInto("di1ee", torrent));
+  ERROR_EQ(bencode::error::EXPECT_VALUE,
+           bencode::ParseInto("d8:announce", torrent));
+}
+
+TEST(binding, file_stream) {
+  const std::string pieces(100000, 'p');
+  const auto bencode = "d6:pieces" + std::to_string(pieces.size()) + ":" +
+                       pieces + "7:skippedd1:a" +
+                       std::to_string(pieces.size()) + ":" + pieces + "ee";
+
+  const TempFile file(bencode);
+  ASSERT_NE(nullptr, file.get());
+
+  char buffer[4096];
+  bencode::FileReadStream read_stream(file.get(), buffer);
+  Info info;
+  ERROR_EQ(bencode::error::OK, bencode::ParseStreamInto(read_stream, info));
+
+  EXPECT_EQ(pieces, info.pieces_);
+}
+
+TEST(binding, write) {
+  Reply reply;
+  reply.t_ = "aa";
+  reply.r_.id_ = "0123456789abcdefghij";
+  reply.r_.ports_ = {6881, 51413};
+  EXPECT_EQ("d1:rd2:id20:0123456789abcdefghij5:portsli6881ei51413eee1:t2:aa"
+            "1:y1:re",
+            Encode(reply));
+
+  reply.v_ = "LT01";
+  const auto bencode = Encode(reply);
+  EXPECT_EQ("d1:rd2:id20:0123456789abcdefghij5:portsli6881ei51413eee1:t2:aa"
+            "1:v4:LT011:y1:re",
+            bencode);
+  ERROR_EQ(bencode::error::OK, bencode::VerifyCanonical(bencode));
+
+  Reply parsed;
+  ERROR_EQ(bencode::error::OK, bencode::ParseInto(bencode, parsed));
+  EXPECT_EQ(reply.t_, parsed.t_);
+  EXPECT_EQ(reply.r_.id_, parsed.r_.id_);
+  EXPECT_EQ(reply.r_.ports_, parsed.r_.ports_);
+  EXPECT_EQ(reply.v_, parsed.v_);
+}
+
+TEST(binding, write_round_trip) {
+  Torrent torrent;
+  ERROR_EQ(bencode::error::OK, bencode::ParseInto(kTorrent, torrent));
+  const auto bencode = Encode(torrent);
+  ERROR_EQ(bencode::error::OK, bencode::VerifyCanonical(bencode));
+  // the same torrent without the keys the structs do not know about
+  EXPECT_EQ("d8:announce16:http://tracker/a13:creation datei1671279452e"
+            "4:infod5:filesld6:lengthi12e4:pathl5:a.txteed6:lengthi7e"
+            "4:pathl3:dir5:b.txteee4:name4:test12:piece lengthi16384e"
+            "6:pieces20:01234567890123456789ee",
+            bencode);
+
+  EXPECT_EQ("li1ei-2ee", Encode(std::vector<int64_t>{1, -2}));
+  EXPECT_EQ("l1:ae", Encode(std::vector<std::string>{"a"}));
+  EXPECT_EQ("le", Encode(std::vector<int32_t>{}));
+}
+
+TEST(binding, write_out_of_range) {
+  Torrent torrent;
+  torrent.creation_date_ = UINT64_MAX;
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  EXPECT_FALSE(bencode::WriteTo(torrent, writer));
+
+  torrent.creation_date_ = INT64_MAX;
+  EXPECT_NE(std::string::npos,
+            Encode(torrent).find("13:creation datei9223372036854775807e"));
+}
+
+#if defined(__GNUC__)
+BENCODE_DIAG_POP
+#endif
@@ -27,6 +27,9 @@
 #include <cstdint>
 
 #include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "bencode/internal/itoa.h"
 
@@ -156,6 +159,95 @@ TEST(itoa, u64toa) { Verify(u64toa_naive, bencode::internal::u64toa); }
 
 TEST(itoa, i64toa) { Verify(i64toa_naive, bencode::internal::i64toa); }
 
+TEST(itoa, u64toa_lut) { Verify(u64toa_naive, bencode::internal::u64toa_lut); }
+
+#if defined(BENCODE_SSE2)
+TEST(itoa, u64toa_sse2) {
+  Verify(u64toa_naive, bencode::internal::u64toa_sse2);
+}
+#endif
+
+// values of every digit count, with runs of zeros inside
+static std::vector<int64_t> RandomValues() {
+  std::vector<int64_t> values;
+  uint64_t x = 88172645463325252ULL;
+  for (int i = 0; i < 100000; ++i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    const uint64_t mod = 1ULL << (x % 64);
+    auto v = static_cast<int64_t>(x % mod);
+    if (i % 7 == 0) {
+      v = v / 1000 * 1000;
+    }
+    values.push_back(i % 2 == 0 ? v : -v);
+  }
+  return values;
+}
+
+TEST(itoa, random) {
+  for (const auto value : RandomValues()) {
+    VerifyValue<int64_t>(value, i64toa_naive, bencode::internal::i64toa);
+  }
+}
+
+TEST(itoa, i64toa_list) {
+  const auto values = RandomValues();
+  std::string expect;
+  char buffer[Traits<int64_t>::kBufferSize];
+  for (const auto value : values) {
+    i64toa_naive(value, buffer);
+    expect += 'i';
+    expect += buffer;
+    expect += 'e';
+  }
+
+  std::vector<char> list(values.size() *
+                         bencode::internal::kMaxEncodedIntegerSize);
+  char *end = bencode::internal::i64toa_list(values, list.data());
+  EXPECT_EQ(expect, std::string(list.data(), end));
+}
+
+TEST(itoa, buffer_size) {
+  // a heap buffer of exactly kItoaBufferSize bytes lets ASan catch overruns
+  for (const auto value : RandomValues()) {
+    std::vector<char> buffer(bencode::internal::kItoaBufferSize);
+    char *end = bencode::internal::i64toa(value, buffer.data());
+    EXPECT_EQ(std::to_string(value), std::string(buffer.data(), end));
+  }
+  for (const auto value : {uint64_t{0}, uint64_t{12345}, UINT64_MAX}) {
+    std::vector<char> buffer(bencode::internal::kItoaBufferSize);
+    char *end = bencode::internal::u64toa(value, buffer.data());
+    EXPECT_EQ(std::to_string(value), std::string(buffer.data(), end));
+  }
+}
+
+// formats value in a constant expression
+template <typename T, char *(*F)(T, char *)>
+constexpr std::string_view Format(const T value, char (&buffer)[32]) {
+  return {buffer, static_cast<std::size_t>(F(value, buffer) - buffer)};
+}
+
+TEST(itoa, compile_time) {
+  static_assert([] {
+    char buf[32]{};
+    using bencode::internal::i64toa;
+    using bencode::internal::u64toa;
+    return Format<uint64_t, u64toa>(0, buf) == "0" &&
+           Format<uint64_t, u64toa>(UINT64_MAX, buf) ==
+               "18446744073709551615" &&
+           Format<int64_t, i64toa>(INT64_MIN, buf) == "-9223372036854775808" &&
+           Format<int64_t, i64toa>(-100000000, buf) == "-100000000";
+  }());
+  static_assert([] {
+    constexpr int64_t kValues[] = {0, -1, 42};
+    char buf[3 * bencode::internal::kMaxEncodedIntegerSize]{};
+    const char *end = bencode::internal::i64toa_list(kValues, buf);
+    return std::string_view(buf, static_cast<std::size_t>(end - buf)) ==
+           "i0ei-1ei42e";
+  }());
+}
+
 #if defined(__GNUC__) && !defined(__clang__)
 BENCODE_DIAG_POP
 #endif
@@ -0,0 +1,155 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+
+#include "bencode/canonical.h"
+#include "bencode/exception.h"
+#include "bencode/literal.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// a KRPC ping query, the 20 byte id is patched in before it is sent
+constexpr auto kPing = bencode::ParseLiteral(
+    "d1:ad2:id20:abcdefghij0123456789e1:q4:ping1:t2:aa1:y1:qe");
+
+// the offset of the id payload, found once by the compiler
+constexpr std::size_t kIdOffset = [] {
+  const auto a = kPing.FindMember(0, "a");
+  return kPing.tape()[kPing.FindMember(a, "id")].offset_;
+}();
+
+static_assert(kPing.view().substr(kIdOffset, 20) == "abcdefghij0123456789");
+static_assert(kPing.tape().size() == 11);
+static_assert(kPing.FindMember(0, "r") == kPing.tape().size());
+
+// a tracker failure, encoded by the compiler
+constexpr auto kFailure = [] {
+  bencode::LiteralWriter<64> writer;
+  writer.StartDict();
+  writer.Key("failure reason");
+  writer.String("unregistered torrent");
+  writer.Key("interval");
+  writer.Integer(-1800);
+  writer.EndDict();
+  return writer;
+}();
+
+static_assert(kFailure.view() ==
+              "d14:failure reason20:unregistered torrent8:intervali-1800ee");
+
+template <std::size_t N> std::string Encode(const bencode::Literal<N> &lit) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  EXPECT_TRUE(lit.WriteTo(writer));
+  return std::string(os.get());
+}
+
+bencode::error::ParseError Error(const std::string_view bencode) {
+  try {
+    (void)bencode::ParseLiteral<64>(bencode);
+  } catch (const bencode::Exception &e) {
+    return e.err();
+  }
+  return bencode::error::OK;
+}
+
+} // namespace
+
+TEST(literal, tape) {
+  constexpr auto lit = bencode::ParseLiteral("d1:ali-3e0:lee4:spam3:egge");
+  static_assert(lit.tape().size() == 8);
+
+  const auto tape = lit.tape();
+  EXPECT_EQ(bencode::B_DICT, tape[0].type_);
+  EXPECT_EQ(2u, tape[0].size_);
+  EXPECT_EQ(tape.size(), tape[0].next_);
+  EXPECT_EQ("a", lit.GetString(tape[1]));
+  EXPECT_EQ(bencode::B_LIST, tape[2].type_);
+  EXPECT_EQ(3u, tape[2].size_);
+  EXPECT_EQ(6u, tape[2].next_);
+  EXPECT_EQ(-3, tape[3].integer_);
+  EXPECT_EQ("", lit.GetString(tape[4]));
+  EXPECT_EQ(bencode::B_LIST, tape[5].type_);
+  EXPECT_EQ(0u, tape[5].size_);
+  EXPECT_EQ("spam", lit.GetString(tape[6]));
+  EXPECT_EQ("egg", lit.GetString(tape[7]));
+  EXPECT_EQ(std::string_view("d1:ali-3e0:lee4:spam3:egge").size(),
+            lit.view().size());
+  EXPECT_EQ(7u, lit.FindMember(0, "spam"));
+}
+
+TEST(literal, write) {
+  EXPECT_EQ(kPing.view(), Encode(kPing));
+  constexpr auto failure = bencode::ParseLiteral<64>(kFailure.view());
+  EXPECT_EQ(kFailure.view(), Encode(failure));
+  EXPECT_EQ(bencode::error::OK, bencode::VerifyCanonical(kFailure.view()));
+
+  // replaying a literal into a LiteralWriter is a constant expression too
+  static_assert([] {
+    bencode::LiteralWriter<kPing.view().size()> writer;
+    return kPing.WriteTo(writer) && writer.view() == kPing.view();
+  }());
+}
+
+TEST(literal, integers) {
+  static_assert(bencode::ParseLiteral("i9223372036854775807e").tape()[0]
+                    .integer_ == INT64_MAX);
+  static_assert(bencode::ParseLiteral("i-9223372036854775808e").tape()[0]
+                    .integer_ == INT64_MIN);
+  EXPECT_EQ(bencode::error::NUMBER_TOO_BIG, Error("i9223372036854775808e"));
+  EXPECT_EQ(bencode::error::NUMBER_TOO_BIG, Error("i-9223372036854775809e"));
+}
+
+TEST(literal, errors) {
+  using namespace bencode::error;
+  EXPECT_EQ(EXPECT_VALUE, Error(""));
+  EXPECT_EQ(BAD_VALUE, Error("x"));
+  EXPECT_EQ(BAD_VALUE, Error("ie"));
+  EXPECT_EQ(BAD_VALUE, Error("i-e"));
+  EXPECT_EQ(LEADING_PLUS, Error("i+1e"));
+  EXPECT_EQ(NEGATIVE_ZERO, Error("i-0e"));
+  EXPECT_EQ(LEADING_ZERO, Error("i01e"));
+  EXPECT_EQ(LEADING_ZERO, Error("01:a"));
+  EXPECT_EQ(MISS_TRAILING_E, Error("i12"));
+  EXPECT_EQ(MISS_COLON, Error("1a"));
+  EXPECT_EQ(MISS_STRING_DATA, Error("5:ab"));
+  EXPECT_EQ(MISS_STRING_DATA, Error("99999999999999999999:a"));
+  EXPECT_EQ(EXPECT_VALUE, Error("l"));
+  EXPECT_EQ(EXPECT_VALUE, Error("llllllll"));
+  EXPECT_EQ(MISS_KEY, Error("di1ei2ee"));
+  EXPECT_EQ(MISS_KEY, Error("d"));
+  EXPECT_EQ(UNSORTED_KEYS, Error("d1:bi1e1:ai2ee"));
+  EXPECT_EQ(DUPLICATE_KEY, Error("d1:ai1e1:ai2ee"));
+  EXPECT_EQ(ROOT_NOT_SINGULAR, Error("i1ei2e"));
+  EXPECT_EQ(TOTAL_BYTES_EXCEEDED, Error(std::string(65, 'l')));
+
+  bencode::LiteralWriter<4> writer;
+  EXPECT_THROW(writer.String("four"), bencode::Exception);
+}
@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bencode/document.h"
+#include "bencode/exception.h"
+#include "bencode/metainfo.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+#define ERROR_EQ(expect, actual)                                               \
+  do {                                                                         \
+    EXPECT_STREQ(bencode::ParseErrorStr((expect)),                             \
+                 bencode::ParseErrorStr((actual)));                            \
+  } while (0) //
+
+namespace {
+
+bencode::Digest MakeDigest(const char fill) {
+  bencode::Digest digest{};
+  digest.fill(static_cast<std::byte>(fill));
+  return digest;
+}
+
+std::string Torrent(const std::string_view pieces) {
+  return "d4:infod6:lengthi1e4:name1:a12:piece lengthi16384e6:pieces" +
+         std::to_string(pieces.size()) + ":" + std::string(pieces) + "ee";
+}
+
+bencode::error::ParseError PiecesError(const std::string_view bencode) {
+  bencode::Document doc;
+  EXPECT_EQ(bencode::error::OK, doc.Parse(bencode));
+  try {
+    (void)bencode::Metainfo(doc).Pieces();
+  } catch (const bencode::Exception &e) {
+    return e.err();
+  }
+  return bencode::error::OK;
+}
+
+} // namespace
+
+TEST(metainfo, pieces) {
+  const std::string pieces =
+      std::string(20, 'a') + std::string(20, 'b') + std::string(20, 'c');
+  bencode::Document doc;
+  ERROR_EQ(bencode::error::OK, doc.Parse(Torrent(pieces)));
+
+  const bencode::Metainfo metainfo(doc);
+  EXPECT_EQ(16384, metainfo.PieceLength());
+  const auto digests = metainfo.Pieces();
+  ASSERT_EQ(3UL, digests.size());
+  EXPECT_TRUE(std::ranges::equal(MakeDigest('a'), digests[0]));
+  EXPECT_TRUE(std::ranges::equal(MakeDigest('c'), digests[2]));
+  EXPECT_EQ(MakeDigest('b'), digests.at(1));
+  EXPECT_THROW((void)digests.at(3), std::out_of_range);
+
+  // the digests are the parsed bytes, not a copy
+  const auto stored = metainfo.Info()["pieces"].GetStringView();
+  EXPECT_EQ(static_cast<const void *>(stored.data()),
+            static_cast<const void *>(digests[0].data()));
+}
+
+TEST(metainfo, outlives_document) {
+  const std::string pieces = std::string(20, 'a') + std::string(20, 'b');
+  std::optional<bencode::Metainfo> metainfo;
+  {
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse(Torrent(pieces)));
+    metainfo.emplace(doc);
+  }
+  EXPECT_EQ(16384, metainfo->PieceLength());
+  EXPECT_EQ(MakeDigest('b'), metainfo->Pieces().at(1));
+}
+
+TEST(metainfo, errors) {
+  ERROR_EQ(bencode::error::OK, PiecesError(Torrent("")));
+  using namespace bencode::error;
+  ERROR_EQ(BAD_PIECES, PiecesError(Torrent(std::string(19, 'x'))));
+  ERROR_EQ(BAD_PIECES, PiecesError(Torrent(std::string(41, 'x'))));
+  ERROR_EQ(MISS_MEMBER, PiecesError("d4:name1:ae"));
+  ERROR_EQ(MISS_MEMBER, PiecesError("d4:infod4:name1:aee"));
+  ERROR_EQ(TYPE_MISMATCH, PiecesError("d4:infoi1ee"));
+  ERROR_EQ(TYPE_MISMATCH, PiecesError("d4:infod6:piecesi1eee"));
+  ERROR_EQ(TYPE_MISMATCH, PiecesError("le"));
+}
+
+TEST(metainfo, write_pieces) {
+  const std::vector<bencode::Digest> first = {MakeDigest('a'),
+                                              MakeDigest('b')};
+  const std::array<bencode::Digest, 1> second = {MakeDigest('c')};
+  const std::span<const bencode::Digest> runs[] = {first, {}, second};
+  const std::string pieces =
+      std::string(20, 'a') + std::string(20, 'b') + std::string(20, 'c');
+
+  // streamed into a writer, one chunk per run
+  {
+    bencode::StringWriteStream os;
+    bencode::ChunkedWriter writer(os);
+    writer.StartDict();
+    writer.Key("pieces");
+    EXPECT_TRUE(bencode::WritePieces(writer, runs));
+    writer.EndDict();
+    EXPECT_EQ("d6:pieces60:" + pieces + "e", os.get());
+
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK,
+             doc.Parse("d4:info" + std::string(os.get()) + "e"));
+    const auto digests = bencode::Metainfo(doc).Pieces();
+    ASSERT_EQ(3UL, digests.size());
+    EXPECT_EQ(first[0], digests.at(0));
+    EXPECT_EQ(first[1], digests.at(1));
+    EXPECT_EQ(second[0], digests.at(2));
+  }
+
+  // a handler without chunks gets the string in one piece
+  {
+    bencode::Document doc;
+    EXPECT_TRUE(bencode::WritePieces(doc, runs));
+    EXPECT_EQ(pieces, doc.GetStringView());
+  }
+  {
+    bencode::StringWriteStream os;
+    bencode::Writer writer(os);
+    EXPECT_TRUE(bencode::WritePieces(writer, second));
+    EXPECT_EQ("20:" + std::string(20, 'c'), os.get());
+  }
+}
@@ -26,16 +26,30 @@
 
 #include <cstdint>
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "bencode/bencode.h"
+#include "bencode/canonical.h"
 #include "bencode/document.h"
 #include "bencode/exception.h"
+#include "bencode/file_read_stream.h"
+#include "bencode/key_table.h"
 #include "bencode/non_copyable.h"
+#include "bencode/parse_stats.h"
 #include "bencode/reader.h"
 #include "bencode/string_read_stream.h"
+#include "bencode/string_write_stream.h"
 #include "bencode/value.h"
+#include "bencode/writer.h"
 
 #include "gtest/gtest.h"
 
+#include "temp_file.h"
+
 #if defined(_MSC_VER) && !defined(__clang__)
 BENCODE_DIAG_PUSH
 #elif defined(__GNUC__)
@@ -298,6 +312,646 @@ TEST(parse, miss_colon) {
   TEST_PARSE_ERROR(bencode::error::MISS_COLON, "1a");
 }
 
+TEST(parse, limits) {
+#define TEST_LIMIT_ERROR(error, b, field, value)                               \
+  do {                                                                         \
+    bencode::ParseLimits limits;                                               \
+    limits.field = (value);                                                    \
+    bencode::StringReadStream read_stream(b);                                  \
+    TestHandler test_handler;                                                  \
+    ERROR_EQ((error),                                                          \
+             bencode::Reader::Parse(read_stream, test_handler, limits));       \
+  } while (0)
+
+  TEST_LIMIT_ERROR(bencode::error::OK, "lli1eee", max_depth_, 2);
+  TEST_LIMIT_ERROR(bencode::error::OK, "le", max_depth_, 1);
+  TEST_LIMIT_ERROR(bencode::error::DEPTH_LIMIT_EXCEEDED, "llleee", max_depth_,
+                   2);
+  TEST_LIMIT_ERROR(bencode::error::DEPTH_LIMIT_EXCEEDED, "d1:ad1:bleee",
+                   max_depth_, 2);
+
+  TEST_LIMIT_ERROR(bencode::error::OK, "d3:abc3:defe", max_string_length_, 3);
+  TEST_LIMIT_ERROR(bencode::error::STRING_TOO_LONG, "4:abcd",
+                   max_string_length_, 3);
+  TEST_LIMIT_ERROR(bencode::error::STRING_TOO_LONG, "d4:abcdi1ee",
+                   max_string_length_, 3);
+  // the declared length is rejected before any data is read
+  TEST_LIMIT_ERROR(bencode::error::STRING_TOO_LONG, "999999999999:",
+                   max_string_length_, 1 << 20);
+
+  TEST_LIMIT_ERROR(bencode::error::OK, "li1ei2ee", max_elements_, 3);
+  TEST_LIMIT_ERROR(bencode::error::TOO_MANY_ELEMENTS, "li1ei2ei3ee",
+                   max_elements_, 3);
+  TEST_LIMIT_ERROR(bencode::error::OK, "d1:ai1e1:bi2ee", max_elements_, 3);
+
+  TEST_LIMIT_ERROR(bencode::error::OK, "d1:a2:bce", max_total_bytes_, 3);
+  TEST_LIMIT_ERROR(bencode::error::TOTAL_BYTES_EXCEEDED, "d1:a3:bcde",
+                   max_total_bytes_, 3);
+
+#undef TEST_LIMIT_ERROR
+
+  bencode::ParseLimits limits;
+  limits.max_depth_ = 64;
+  {
+    const auto nested = std::string(100000, 'l') + std::string(100000, 'e');
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::DEPTH_LIMIT_EXCEEDED, doc.Parse(nested, limits));
+  }
+  {
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse("l1:ai1ee", limits));
+    EXPECT_EQ(2UL, doc.GetList()->size());
+  }
+
+  // digits are not buffered past what an int64_t can hold
+  const auto integer = "i" + std::string(1 << 20, '1') + "e";
+  TEST_PARSE_ERROR(bencode::error::NUMBER_TOO_BIG, integer);
+  const auto length = std::string(1 << 20, '1') + ":";
+  TEST_PARSE_ERROR(bencode::error::NUMBER_TOO_BIG, length);
+  TEST_PARSE_ERROR(bencode::error::OK, "i-9223372036854775808e");
+}
+
+class ChunkHandler : public TestHandler {
+  std::string string_;
+  std::size_t length_ = 0;
+  std::size_t max_chunk_ = 0;
+  std::size_t chunks_ = 0;
+
+public:
+  bool StringStart(const std::size_t length) {
+    string_.clear();
+    length_ = length;
+    return true;
+  }
+  bool StringChunk(const std::string_view str) {
+    string_.append(str);
+    max_chunk_ = std::max(max_chunk_, str.size());
+    ++chunks_;
+    return true;
+  }
+  bool StringEnd() { return String(string_); }
+
+  [[nodiscard]] const std::string &string() const { return string_; }
+  [[nodiscard]] std::size_t length() const { return length_; }
+  [[nodiscard]] std::size_t max_chunk() const { return max_chunk_; }
+  [[nodiscard]] std::size_t chunks() const { return chunks_; }
+};
+
+TEST(parse, string_chunks) {
+  {
+    bencode::StringReadStream read_stream("5:Hello");
+    ChunkHandler handler;
+    ERROR_EQ(bencode::error::OK, bencode::Reader::Parse(read_stream, handler));
+    EXPECT_EQ(bencode::B_STRING, handler.type());
+    EXPECT_EQ(5UL, handler.length());
+    EXPECT_EQ(1UL, handler.chunks());
+    EXPECT_EQ("Hello", handler.string());
+  }
+  {
+    std::string payload(300000, '\0');
+    for (std::size_t i = 0; i < payload.size(); ++i) {
+      payload[i] = static_cast<char>(i * 31 % 251);
+    }
+    const auto bencode = std::to_string(payload.size()) + ":" + payload;
+
+    const TempFile file(bencode);
+    ASSERT_NE(nullptr, file.get());
+
+    char buffer[4096];
+    bencode::FileReadStream read_stream(file.get(), buffer);
+    ChunkHandler handler;
+    ERROR_EQ(bencode::error::OK, bencode::Reader::Parse(read_stream, handler));
+
+    EXPECT_EQ(payload.size(), handler.length());
+    EXPECT_EQ(payload, handler.string());
+    EXPECT_GE(sizeof(buffer), handler.max_chunk());
+  }
+  {
+    bencode::StringReadStream read_stream("10:Hello");
+    ChunkHandler handler;
+    ERROR_EQ(bencode::error::MISS_STRING_DATA,
+             bencode::Reader::Parse(read_stream, handler));
+  }
+}
+
+TEST(parse, string_chunks_to_writer) {
+  const std::string_view ss(R"(d1:s3:abc1:ll0:4:spame5:emptyd0:0:ee)");
+  bencode::StringReadStream read_stream(ss);
+  bencode::StringWriteStream write_stream;
+  bencode::ChunkedWriter writer(write_stream);
+  ERROR_EQ(bencode::error::OK, bencode::Reader::Parse(read_stream, writer));
+  EXPECT_EQ(ss, write_stream.get());
+}
+
+TEST(parse, iterative) {
+  // both engines hand the same events to the handler and fail the same way
+  for (const std::string_view ss :
+       {"i-42e", "0:", "4:spam", "le", "de", "li1el4:spamee",
+        "d1:ad1:bl0:eee1:ci0ee", "lllleeee", "d1:ai1e1:bld1:ci2eeee", "",
+        "l", "d", "li1e", "d1:a", "d1:ai1e", "di1ei2ee", "lx", "ld", "le1",
+        "l4:spa", "i1ee", "d1:ale1:bd"}) {
+    bencode::StringReadStream recursive_rs(ss);
+    bencode::StringWriteStream recursive_ws;
+    bencode::Writer recursive_writer(recursive_ws);
+    const auto recursive_err =
+        bencode::Reader::Parse(recursive_rs, recursive_writer);
+
+    bencode::StringReadStream iterative_rs(ss);
+    bencode::StringWriteStream iterative_ws;
+    bencode::Writer iterative_writer(iterative_ws);
+    const auto iterative_err =
+        bencode::Reader::IterativeParse(iterative_rs, iterative_writer);
+
+    ERROR_EQ(recursive_err, iterative_err);
+    EXPECT_EQ(recursive_ws.get(), iterative_ws.get()) << ss;
+  }
+
+  // deep enough to overflow a small stack if parsed recursively
+  {
+    constexpr std::size_t kDepth = 1 << 18;
+    const auto nested =
+        std::string(kDepth, 'l') + "d1:ai1ee" + std::string(kDepth, 'e');
+    bencode::StringReadStream read_stream(nested);
+    bencode::StringWriteStream write_stream;
+    bencode::Writer writer(write_stream);
+    ERROR_EQ(bencode::error::OK,
+             bencode::Reader::IterativeParse(read_stream, writer));
+    EXPECT_EQ(nested, write_stream.get());
+
+    bencode::ParseLimits limits;
+    limits.max_depth_ = kDepth;
+    bencode::StringReadStream limited_stream(nested);
+    TestHandler test_handler;
+    ERROR_EQ(bencode::error::DEPTH_LIMIT_EXCEEDED,
+             bencode::Reader::IterativeParse(limited_stream, test_handler,
+                                             limits));
+
+    // the values are freed without recursing once per level either
+    auto doc = std::make_unique<bencode::Document>();
+    bencode::StringReadStream doc_stream(nested);
+    ERROR_EQ(bencode::error::OK,
+             bencode::Reader::IterativeParse(doc_stream, *doc));
+    const bencode::Value *value = doc.get();
+    for (std::size_t i = 0; i < kDepth; ++i) {
+      ASSERT_EQ(1UL, value->GetSize());
+      value = &(*value)[0];
+    }
+    EXPECT_EQ(1, (*value)["a"].GetInteger());
+    bencode::Value copy = (*doc)[0];
+    doc.reset();
+    EXPECT_EQ(1UL, copy.GetSize());
+    copy = bencode::Value();
+    EXPECT_TRUE(copy.IsNull());
+  }
+
+  {
+    bencode::Document doc;
+    bencode::StringReadStream read_stream("d1:ali1ei2ee1:b0:e");
+    ERROR_EQ(bencode::error::OK,
+             bencode::Reader::IterativeParse(read_stream, doc));
+    EXPECT_EQ(2UL, doc.GetDict()->size());
+    EXPECT_EQ(2UL, doc["a"].GetList()->size());
+  }
+}
+
+TEST(parse, flags) {
+#define TEST_FLAGS_ERROR(error, flags, b)                                      \
+  do {                                                                         \
+    bencode::StringReadStream read_stream(b);                                  \
+    TestHandler test_handler;                                                  \
+    ERROR_EQ((error),                                                          \
+             bencode::Reader::Parse<(flags)>(read_stream, test_handler));      \
+    bencode::StringReadStream iterative_stream(b);                             \
+    TestHandler iterative_handler;                                             \
+    ERROR_EQ((error), bencode::Reader::IterativeParse<(flags)>(                \
+                          iterative_stream, iterative_handler));               \
+  } while (0)
+
+  using namespace bencode;
+
+  TEST_FLAGS_ERROR(error::ROOT_NOT_SINGULAR, kParseDefaultFlags, "i1ei2e");
+  TEST_FLAGS_ERROR(error::OK, kParseStopWhenDoneFlag, "i1ei2e");
+  TEST_FLAGS_ERROR(error::OK, kParseStopWhenDoneFlag, "d1:ai1ee0:");
+  {
+    StringReadStream read_stream("li1eel");
+    TestHandler test_handler;
+    ERROR_EQ(error::OK, Reader::Parse<kParseStopWhenDoneFlag>(read_stream,
+                                                              test_handler));
+    EXPECT_EQ(5UL, read_stream.tell());
+  }
+
+  TEST_FLAGS_ERROR(error::OK, kParseDefaultFlags, "i+1e");
+  TEST_FLAGS_ERROR(error::LEADING_PLUS, kParseNoLeadingPlusFlag, "i+1e");
+  TEST_FLAGS_ERROR(error::OK, kParseNoLeadingPlusFlag, "i-0e");
+
+  TEST_FLAGS_ERROR(error::OK, kParseStrictFlag, "li0ei-10e3:abc0:e");
+  TEST_FLAGS_ERROR(error::LEADING_PLUS, kParseStrictFlag, "i+1e");
+  TEST_FLAGS_ERROR(error::NEGATIVE_ZERO, kParseStrictFlag, "i-0e");
+  TEST_FLAGS_ERROR(error::LEADING_ZERO, kParseStrictFlag, "i03e");
+  TEST_FLAGS_ERROR(error::LEADING_ZERO, kParseStrictFlag, "03:abc");
+  TEST_FLAGS_ERROR(error::LEADING_ZERO, kParseStrictFlag, "d01:ai1ee");
+
+  TEST_FLAGS_ERROR(error::OK, kParseDefaultFlags, "d1:bi1e1:ai2ee");
+  TEST_FLAGS_ERROR(error::OK, kParseValidateKeyOrderFlag,
+                   "d1:ai1e2:aai2e1:bd1:ai3eee");
+  TEST_FLAGS_ERROR(error::UNSORTED_KEYS, kParseValidateKeyOrderFlag,
+                   "d1:bi1e1:ai2ee");
+  TEST_FLAGS_ERROR(error::DUPLICATE_KEY, kParseValidateKeyOrderFlag,
+                   "d1:ai1e1:ai2ee");
+  // the order is per dict and compares unsigned bytes
+  TEST_FLAGS_ERROR(error::OK, kParseValidateKeyOrderFlag,
+                   "d1:bd1:ai1ee1:cd1:ai1ee1:\xffi0ee");
+  TEST_FLAGS_ERROR(error::UNSORTED_KEYS, kParseValidateKeyOrderFlag,
+                   "d1:bld1:ci1e1:bi1eee1:cde");
+
+#undef TEST_FLAGS_ERROR
+
+  // keys and strings inside the buffer are not copied, those that straddle a
+  // refill are, the document is the same either way
+  {
+    std::string bencode = "l";
+    for (int i = 0; i < 200; ++i) {
+      bencode += "d3:key" + std::to_string(i % 10) + ":" +
+                 std::string(static_cast<std::size_t>(i % 10), 'v') + "e";
+    }
+    bencode += "e";
+
+    const TempFile file(bencode);
+    ASSERT_NE(nullptr, file.get());
+
+    char buffer[16];
+    FileReadStream read_stream(file.get(), buffer);
+    Document doc;
+    ERROR_EQ(error::OK, doc.ParseStream<kParseNoCopyFlag>(read_stream));
+
+    StringWriteStream write_stream;
+    Writer writer(write_stream);
+    ASSERT_TRUE(doc.WriteTo(writer));
+    EXPECT_EQ(bencode, write_stream.get());
+  }
+}
+
+TEST(parse, canonical) {
+  using namespace bencode;
+
+  // canonical exactly when re-encoding gives back the same bytes
+  for (const std::string_view ss :
+       {"i0e", "i-1e", "0:", "le", "de", "d1:ad1:bi1eee",
+        "d8:announce3:url4:infod6:lengthi1024e4:name4:fileee",
+        "d0:i0e1:\x01i1e1:\xffi2ee", "l0:0:de1:ai0ee"}) {
+    ERROR_EQ(error::OK, VerifyCanonical(ss));
+    Document doc;
+    ERROR_EQ(error::OK, doc.Parse(ss));
+    StringWriteStream write_stream;
+    Writer writer(write_stream);
+    ASSERT_TRUE(doc.WriteTo(writer));
+    EXPECT_EQ(ss, write_stream.get());
+  }
+
+  ERROR_EQ(error::LEADING_PLUS, VerifyCanonical("i+1e"));
+  ERROR_EQ(error::NEGATIVE_ZERO, VerifyCanonical("i-0e"));
+  ERROR_EQ(error::LEADING_ZERO, VerifyCanonical("i00e"));
+  ERROR_EQ(error::LEADING_ZERO, VerifyCanonical("l01:ae"));
+  ERROR_EQ(error::UNSORTED_KEYS, VerifyCanonical("d1:bi0e1:ai0ee"));
+  ERROR_EQ(error::UNSORTED_KEYS, VerifyCanonical("d2:abi0e1:ai0ee"));
+  ERROR_EQ(error::DUPLICATE_KEY, VerifyCanonical("d1:ai0e1:ai0ee"));
+  ERROR_EQ(error::UNSORTED_KEYS, VerifyCanonical("ld1:ai0eed1:bd1:cle1:bleee"));
+  ERROR_EQ(error::ROOT_NOT_SINGULAR, VerifyCanonical("i0ei0e"));
+  ERROR_EQ(error::EXPECT_VALUE, VerifyCanonical("li0e"));
+
+  // nothing is copied or nested on the native stack
+  {
+    const auto nested = std::string(1 << 16, 'l') + std::string(1 << 16, 'e');
+    ERROR_EQ(error::OK, VerifyCanonical(nested));
+  }
+  {
+    const auto bencode = "d3:key" + std::to_string(1 << 20) + ":" +
+                         std::string(1 << 20, 'x') + "e";
+    const TempFile file(bencode);
+    ASSERT_NE(nullptr, file.get());
+
+    char buffer[4096];
+    FileReadStream read_stream(file.get(), buffer);
+    ERROR_EQ(error::OK, VerifyCanonical(read_stream));
+  }
+}
+
+// a clock that advances one microsecond per read and counts the reads
+struct CountingClock {
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<CountingClock>;
+  static constexpr bool is_steady = true;
+
+  static inline std::size_t reads_ = 0;
+
+  static time_point now() {
+    return time_point(std::chrono::microseconds(++reads_));
+  }
+};
+
+TEST(parse, stats) {
+  {
+    bencode::ParseStats stats;
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK,
+             doc.Parse("d1:ai1e2:bbl3:xyzi-2eld1:c0:eee1:dde4:long5:helloe",
+                       stats));
+    EXPECT_EQ(2UL, stats.integers_);
+    EXPECT_EQ(3UL, stats.strings_);
+    EXPECT_EQ(5UL, stats.keys_);
+    EXPECT_EQ(2UL, stats.lists_);
+    EXPECT_EQ(3UL, stats.dicts_);
+    EXPECT_EQ(8UL, stats.string_bytes_);
+    EXPECT_EQ(9UL, stats.key_bytes_);
+    EXPECT_EQ(5UL, stats.largest_string_);
+    EXPECT_EQ(4UL, stats.max_depth_);
+    EXPECT_EQ(4UL, stats.max_dict_size_);
+    EXPECT_EQ(1UL, stats.dict_size_histogram_[0]);
+    EXPECT_EQ(1UL, stats.dict_size_histogram_[1]);
+    EXPECT_EQ(1UL, stats.dict_size_histogram_[3]);
+    EXPECT_LE(stats.handler_time_, stats.total_time_);
+    EXPECT_EQ(4UL, doc.GetSize());
+  }
+  {
+    bencode::ParseStats stats;
+    bencode::StringReadStream read_stream("l5:abc");
+    ChunkHandler handler;
+    bencode::StatsHandler stats_handler(handler, stats);
+    ERROR_EQ(bencode::error::MISS_STRING_DATA,
+             bencode::Reader::Parse(read_stream, stats_handler));
+    EXPECT_EQ(1UL, stats.strings_);
+    EXPECT_EQ(5UL, stats.largest_string_);
+    EXPECT_EQ(1UL, stats.max_depth_);
+  }
+  {
+    // flags and limits apply as without stats
+    bencode::ParseStats stats;
+    bencode::Document strict;
+    ERROR_EQ(bencode::error::NEGATIVE_ZERO,
+             strict.Parse<bencode::kParseStrictFlag>("i-0e", stats));
+    bencode::ParseLimits limits;
+    limits.max_depth_ = 1;
+    bencode::Document limited;
+    ERROR_EQ(bencode::error::DEPTH_LIMIT_EXCEEDED,
+             limited.Parse("llee", stats, limits));
+    bencode::Document packed;
+    ERROR_EQ(bencode::error::OK,
+             packed.Parse<bencode::kParsePackListsFlag>("li1ei2ee", stats));
+    EXPECT_TRUE(packed.IsPacked());
+  }
+  {
+    // the clock is read for a sample of the events only
+    constexpr std::size_t kIntegers = 1000;
+    std::string bencode = "l";
+    for (std::size_t i = 0; i < kIntegers; ++i) {
+      bencode += "i" + std::to_string(i) + "e";
+    }
+    bencode += "e";
+
+    using Handler = bencode::StatsHandler<bencode::Document, CountingClock>;
+    bencode::ParseStats stats;
+    bencode::Document doc;
+    Handler handler(doc, stats);
+    CountingClock::reads_ = 0;
+    bencode::StringReadStream read_stream(bencode);
+    ERROR_EQ(bencode::error::OK, handler.Run([&read_stream](auto &h) {
+      return bencode::Reader::Parse(read_stream, h);
+    }));
+    const std::size_t events = kIntegers + 2;
+    EXPECT_EQ(2 + 2 * ((events + Handler::kSampleInterval - 1) /
+                       Handler::kSampleInterval),
+              CountingClock::reads_);
+    EXPECT_LE(stats.handler_time_, stats.total_time_);
+    EXPECT_EQ(kIntegers, doc.GetSize());
+  }
+}
+
+TEST(parse, memory_usage) {
+  {
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse("l2:hii1ee"));
+    const auto usage = doc.MemoryUsage();
+    const auto &list = doc.GetList();
+    EXPECT_EQ(sizeof(*list) + list->size() * sizeof(bencode::Value) +
+                  sizeof(std::string),
+              usage.node_bytes_);
+    EXPECT_EQ(0UL, usage.string_bytes_);
+    EXPECT_EQ(2 * bencode::internal::kSharedControlBlockSize,
+              usage.control_block_bytes_);
+    EXPECT_LE((list->capacity() - list->size()) * sizeof(bencode::Value),
+              usage.slack_bytes_);
+  }
+  {
+    const std::string payload(100, 'x');
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK,
+             doc.Parse("d100:" + payload + "100:" + payload + "e"));
+    const auto usage = doc.MemoryUsage();
+    EXPECT_LE(payload.size() + 1, usage.key_bytes_);
+    EXPECT_LE(payload.size() + 1, usage.string_bytes_);
+    EXPECT_EQ(usage.key_bytes_ + usage.string_bytes_ + usage.node_bytes_ +
+                  usage.slack_bytes_ + usage.control_block_bytes_,
+              usage.total());
+  }
+  {
+    // copies share the string, it is only counted once
+    bencode::Value str(std::string(100, 'x'));
+    bencode::Value list(bencode::B_LIST);
+    list.AddValue(str);
+    list.AddValue(str);
+    list.AddValue(str);
+    EXPECT_EQ(str.MemoryUsage().string_bytes_,
+              list.MemoryUsage().string_bytes_);
+
+    bencode::Value outer(bencode::B_LIST);
+    outer.AddValue(list);
+    outer.AddValue(list);
+    EXPECT_EQ(list.MemoryUsage().string_bytes_,
+              outer.MemoryUsage().string_bytes_);
+    EXPECT_EQ(list.MemoryUsage().control_block_bytes_ +
+                  bencode::internal::kSharedControlBlockSize,
+              outer.MemoryUsage().control_block_bytes_);
+  }
+}
+
+TEST(parse, packed_list) {
+  const auto encode = [](const bencode::Value &value) {
+    bencode::StringWriteStream os;
+    bencode::Writer writer(os);
+    value.WriteTo(writer);
+    return std::string(os.get());
+  };
+  constexpr auto kPack = bencode::kParsePackListsFlag;
+
+  {
+    // packing is opt-in
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse("li-1ei0ei42ee"));
+    EXPECT_FALSE(doc.IsPacked());
+    EXPECT_EQ(42, doc[2].GetInteger());
+  }
+  {
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse<kPack>("li-1ei0ei42ee"));
+    ASSERT_TRUE(doc.IsPacked());
+    EXPECT_EQ(bencode::B_INTEGER, doc.GetPackedType());
+    EXPECT_EQ(3UL, doc.GetSize());
+    EXPECT_EQ(42, doc.GetIntegers()[2]);
+    EXPECT_EQ("li-1ei0ei42ee", encode(doc));
+    EXPECT_EQ(3 * sizeof(int64_t), doc.MemoryUsage().node_bytes_ -
+                                       sizeof(bencode::PackedList));
+
+    // reading through a non-const value keeps the layout
+    bencode::Value &value = doc;
+    EXPECT_EQ(-1, value.GetIntegers()[0]);
+    EXPECT_EQ(3UL, value.GetSize());
+    EXPECT_EQ(0, value[1].GetInteger());
+    EXPECT_TRUE(doc.IsPacked());
+
+    // elements read the same as those of any list
+    const bencode::Value &elements = doc;
+    const bencode::Value &last = elements[2];
+    EXPECT_EQ(42, last.GetInteger());
+    EXPECT_EQ(&last, &elements[2]);
+    int64_t sum = 0;
+    for (const auto &element : *elements.GetList()) {
+      sum += element.GetInteger();
+    }
+    EXPECT_EQ(41, sum);
+    EXPECT_TRUE(doc.IsPacked());
+    EXPECT_EQ("li-1ei0ei42ee", encode(doc));
+  }
+  {
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK,
+             doc.Parse<kPack>("d4:pathl3:abc0:2:dee1:xlee"));
+    const auto &path = doc["path"];
+    ASSERT_TRUE(path.IsPacked());
+    EXPECT_EQ(bencode::B_STRING, path.GetPackedType());
+    EXPECT_EQ("abc", path.GetPackedString(0));
+    EXPECT_EQ("", path.GetPackedString(1));
+    EXPECT_EQ("de", path.GetPackedString(2));
+    EXPECT_EQ("de", path[2].GetStringView());
+    EXPECT_EQ(3UL, path.GetList()->size());
+    EXPECT_TRUE(path.IsPacked());
+    EXPECT_FALSE(doc["x"].IsPacked());
+    EXPECT_EQ("d4:pathl3:abc0:2:dee1:xlee", encode(doc));
+  }
+  {
+    // a list that is not homogeneous is kept as values
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse<kPack>("li1ei2e1:ali3eee"));
+    EXPECT_FALSE(doc.IsPacked());
+    EXPECT_EQ(2, doc[1].GetInteger());
+    EXPECT_EQ("a", doc[2].GetStringView());
+    EXPECT_TRUE(doc[3].IsPacked());
+    EXPECT_EQ("li1ei2e1:ali3eee", encode(doc));
+  }
+  {
+    // unpacking leaves copies that share the packed elements alone
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse<kPack>("l1:a1:be"));
+    const bencode::Value copy = doc;
+    EXPECT_EQ("a", copy[0].GetStringView());
+    bencode::Value &value = doc;
+    value.Unpack();
+    EXPECT_FALSE(doc.IsPacked());
+    EXPECT_EQ("b", doc[1].GetStringView());
+    value[0].SetInteger(7);
+    value.AddValue(bencode::Value("c"));
+    EXPECT_EQ("li7e1:b1:ce", encode(doc));
+    EXPECT_TRUE(copy.IsPacked());
+    EXPECT_EQ("l1:a1:be", encode(copy));
+  }
+  {
+    // the elements are built once for all readers
+    bencode::Document doc;
+    ERROR_EQ(bencode::error::OK, doc.Parse<kPack>("li1ei2ei3ee"));
+    const bencode::Value &value = doc;
+    std::vector<const bencode::Value *> firsts(4);
+    std::vector<std::thread> threads;
+    for (auto &first : firsts) {
+      threads.emplace_back([&value, &first] { first = &value[0]; });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    for (const auto *first : firsts) {
+      EXPECT_EQ(&value[0], first);
+    }
+    EXPECT_TRUE(doc.IsPacked());
+  }
+}
+
+TEST(parse, key_table) {
+  constexpr std::string_view kFiles =
+      "ld6:lengthi1e4:pathl1:aeed6:lengthi2e4:pathl1:beee";
+
+  bencode::KeyTable keys;
+  bencode::Document first(keys);
+  bencode::Document second(keys);
+  ERROR_EQ(bencode::error::OK, first.Parse(kFiles));
+  ERROR_EQ(bencode::error::OK, second.Parse(kFiles));
+  EXPECT_EQ(2UL, keys.size());
+
+  // every "length" key is the one interned string
+  const auto length = keys.Intern("length");
+  for (const auto *doc : {&first, &second}) {
+    for (const auto &file : *doc->GetList()) {
+      const auto it = file.FindMember(*length);
+      ASSERT_NE(file.MemberEnd(), it);
+      EXPECT_EQ(length->data(), it->key_.GetStringView().data());
+    }
+  }
+  EXPECT_EQ(2, second[1]["length"].GetInteger());
+
+  // shared keys are only counted once
+  bencode::Document plain;
+  ERROR_EQ(bencode::error::OK, plain.Parse(kFiles));
+  EXPECT_LT(first.MemoryUsage().key_bytes_ +
+                first.MemoryUsage().control_block_bytes_,
+            plain.MemoryUsage().key_bytes_ +
+                plain.MemoryUsage().control_block_bytes_);
+
+  // long keys and keys past the cap are not interned
+  bencode::KeyTable small(bencode::KeyTable::kSingleThread, 1);
+  const std::string long_key(bencode::KeyTable::kMaxKeyLength + 1, 'k');
+  EXPECT_NE(small.Intern(long_key), small.Intern(long_key));
+  EXPECT_EQ(small.Intern("a"), small.Intern("a"));
+  EXPECT_NE(small.Intern("b"), small.Intern("b"));
+  EXPECT_EQ(1UL, small.size());
+}
+
+TEST(parse, key_table_threads) {
+  // even threads share one table, odd threads use their own
+  bencode::KeyTable shared(bencode::KeyTable::kThreadSafe);
+  std::vector<bencode::Value> docs(4);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < docs.size(); ++i) {
+    threads.emplace_back([&shared, &out = docs[i], i] {
+      auto &keys = i % 2 == 0 ? shared : bencode::KeyTable::ThreadLocal();
+      for (int n = 0; n < 100; ++n) {
+        bencode::Document doc(keys);
+        ERROR_EQ(bencode::error::OK, doc.Parse("d1:ai1e1:qi2e1:ti3ee"));
+        out = doc;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(3UL, shared.size());
+  const auto t = shared.Intern("t");
+  for (std::size_t i = 0; i < docs.size(); ++i) {
+    EXPECT_EQ(3, docs[i]["t"].GetInteger());
+    const auto key = docs[i].FindMember("t")->key_.GetStringView();
+    EXPECT_EQ(i % 2 == 0, t->data() == key.data());
+  }
+}
+
 #if defined(__GNUC__) || (defined(_MSC_VER) && !defined(__clang__))
 BENCODE_DIAG_POP
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <string>
+#include <string_view>
+
+#include "bencode/document.h"
+#include "bencode/exception.h"
+#include "bencode/patch_document.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+#if defined(__GNUC__)
+BENCODE_DIAG_PUSH
+BENCODE_DIAG_OFF(effc++)
+#endif
+
+constexpr std::string_view kInfo =
+    "d5:filesld6:lengthi12e4:pathl5:a.txteed6:lengthi7e4:pathl3:dir5:b.txteee"
+    "4:name4:test12:piece lengthi16384e6:pieces20:01234567890123456789e";
+
+static std::string Torrent() {
+  return "d8:announce16:http://old/annce13:creation datei1671279452e4:info" +
+         std::string(kInfo) + "8:url-listl12:http://seed/ee";
+}
+
+template <typename T> static std::string Encode(const T &value) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  value.WriteTo(writer);
+  return std::string(os.get());
+}
+
+TEST(patch_document, untouched) {
+  const auto torrent = Torrent();
+  bencode::PatchDocument doc;
+  ASSERT_EQ(bencode::error::OK, doc.Parse(torrent));
+  EXPECT_EQ(4UL, doc.GetSize());
+  EXPECT_EQ(kInfo, doc.GetRaw("info"));
+  EXPECT_EQ(torrent, Encode(doc));
+}
+
+TEST(patch_document, edit) {
+  const auto torrent = Torrent();
+  bencode::PatchDocument doc;
+  ASSERT_EQ(bencode::error::OK, doc.Parse(torrent));
+
+  doc.SetMember("announce", bencode::Value("udp://new:6969"));
+  doc.SetMember("comment", bencode::Value("moved"));
+  EXPECT_TRUE(doc.RemoveMember("url-list"));
+  EXPECT_FALSE(doc.RemoveMember("url-list"));
+
+  const auto out = Encode(doc);
+  EXPECT_EQ("d8:announce14:udp://new:69697:comment5:moved"
+            "13:creation datei1671279452e4:info" +
+                std::string(kInfo) + "e",
+            out);
+
+  // the result is still a valid document
+  bencode::Document parsed;
+  ASSERT_EQ(bencode::error::OK, parsed.Parse(out));
+  EXPECT_EQ("moved", parsed["comment"].GetString());
+  EXPECT_EQ(16384, parsed["info"]["piece length"].GetInteger());
+
+  // handlers without RawValue see the same document
+  bencode::Document copy;
+  ASSERT_TRUE(doc.WriteTo(copy));
+  EXPECT_EQ(out, Encode(copy));
+}
+
+TEST(patch_document, nested) {
+  const auto torrent = Torrent();
+  bencode::PatchDocument doc;
+  ASSERT_EQ(bencode::error::OK, doc.Parse(torrent));
+
+  auto &info = doc.PatchMember("info");
+  EXPECT_EQ(kInfo, Encode(doc.GetMember("info")));
+  info.SetMember("private", bencode::Value(1));
+  EXPECT_EQ("test", info.GetMember("name").GetString());
+  EXPECT_TRUE(doc.GetRaw("info").empty());
+
+  bencode::Document parsed;
+  ASSERT_EQ(bencode::error::OK, parsed.Parse(Encode(doc)));
+  EXPECT_EQ(1, parsed["info"]["private"].GetInteger());
+  EXPECT_EQ(2UL, parsed["info"]["files"].GetSize());
+}
+
+TEST(patch_document, error) {
+  bencode::PatchDocument doc;
+  EXPECT_EQ(bencode::error::EXPECT_VALUE, doc.Parse(""));
+  EXPECT_EQ(bencode::error::MISS_INITIAL_D, doc.Parse("li1ee"));
+  EXPECT_EQ(bencode::error::MISS_KEY, doc.Parse("di1ei2ee"));
+  EXPECT_EQ(bencode::error::MISS_KEY, doc.Parse("d1:ad1:ai1ei2eee"));
+  EXPECT_EQ(bencode::error::MISS_STRING_DATA, doc.Parse("d1:a9:abce"));
+  EXPECT_EQ(bencode::error::MISS_TRAILING_E, doc.Parse("d1:ai12"));
+  EXPECT_EQ(bencode::error::EXPECT_VALUE, doc.Parse("d1:ali1e"));
+  EXPECT_EQ(bencode::error::ROOT_NOT_SINGULAR, doc.Parse("d1:ai1eede"));
+  EXPECT_EQ(0UL, doc.GetSize());
+}
+
+TEST(patch_document, same_grammar_as_reader) {
+  for (const std::string_view member :
+       {"i+5e", "i-0e", "i0e", "i03e", "ie", "i-e", "i+-5e",
+        "i9223372036854775807e", "i9223372036854775808e",
+        "i-9223372036854775808e", "i-9223372036854775809e",
+        "i123456789012345678901e", "li+1ei2ee", "d1:bi+0ee"}) {
+    const auto bencode = "d1:a" + std::string(member) + "e";
+    bencode::Document expect;
+    const auto err = expect.Parse(bencode);
+
+    bencode::PatchDocument doc;
+    ASSERT_EQ(err, doc.Parse(bencode)) << member;
+    if (err == bencode::error::OK) {
+      EXPECT_EQ(Encode(expect["a"]), Encode(doc.GetMember("a"))) << member;
+    }
+  }
+}
+
+#if defined(__GNUC__)
+BENCODE_DIAG_POP
+#endif
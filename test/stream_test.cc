@@ -0,0 +1,336 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <cstdio>
+
+#include <limits>
+#include <new>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include <unistd.h>
+
+#include "bencode/document.h"
+#include "bencode/fd_write_stream.h"
+#include "bencode/file_read_stream.h"
+#include "bencode/istream_wrapper.h"
+#include "bencode/ostream_wrapper.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+#include "temp_file.h"
+
+#if defined(__GNUC__)
+BENCODE_DIAG_PUSH
+BENCODE_DIAG_OFF(effc++)
+#endif
+
+// stream buffer without a get area, every byte goes through uflow()
+class UnbufferedStreamBuf : public std::streambuf {
+  std::string data_;
+  std::size_t pos_ = 0;
+
+public:
+  explicit UnbufferedStreamBuf(std::string data) : data_(std::move(data)) {}
+
+protected:
+  int_type underflow() override {
+    return pos_ < data_.size() ? traits_type::to_int_type(data_[pos_])
+                               : traits_type::eof();
+  }
+  int_type uflow() override {
+    return pos_ < data_.size() ? traits_type::to_int_type(data_[pos_++])
+                               : traits_type::eof();
+  }
+};
+
+// unbuffered stream buffer counting the calls it receives
+class CountingStreamBuf : public std::streambuf {
+  std::string data_;
+  std::size_t calls_ = 0;
+
+public:
+  [[nodiscard]] const std::string &data() const { return data_; }
+  [[nodiscard]] std::size_t calls() const { return calls_; }
+
+protected:
+  int_type overflow(const int_type ch) override {
+    ++calls_;
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      data_.push_back(traits_type::to_char_type(ch));
+    }
+    return ch;
+  }
+  std::streamsize xsputn(const char *s, const std::streamsize n) override {
+    ++calls_;
+    data_.append(s, static_cast<std::size_t>(n));
+    return n;
+  }
+};
+
+static std::string LongString(const std::size_t n) {
+  std::string str(n, '\0');
+  for (std::size_t i = 0; i < n; ++i) {
+    str[i] = static_cast<char>('a' + i % 26);
+  }
+  return str;
+}
+
+TEST(istream_wrapper, borrowed_get_area) {
+  std::stringstream ss("d3:key5:valuee");
+  {
+    bencode::IStreamWrapper is(ss);
+    EXPECT_EQ('d', is.next());
+    is.skip(5);
+    const auto view = is.next(6);
+    EXPECT_EQ("5:valu", view);
+  }
+  // consumed bytes are committed back to the stream buffer
+  EXPECT_EQ('e', ss.get());
+}
+
+TEST(istream_wrapper, unbuffered) {
+  const auto payload = LongString(1000);
+  const auto bencode = "l" + std::to_string(payload.size()) + ":" + payload +
+                       "i-42ee";
+
+  UnbufferedStreamBuf sb(bencode);
+  std::istream in(&sb);
+  char buffer[16];
+  bencode::IStreamWrapper is(in, buffer);
+
+  bencode::Document doc;
+  ASSERT_EQ(bencode::error::OK, doc.ParseStream(is));
+  ASSERT_EQ(2UL, doc.GetSize());
+  EXPECT_EQ(payload, doc[0].GetString());
+  EXPECT_EQ(-42, doc[1].GetInteger());
+}
+
+TEST(istream_wrapper, string_chunks) {
+  const auto payload = LongString(100000);
+  const auto bencode = "d4:data" + std::to_string(payload.size()) + ":" +
+                       payload + "e";
+
+  UnbufferedStreamBuf sb(bencode);
+  std::istream in(&sb);
+  bencode::IStreamWrapper is(in);
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  ASSERT_EQ(bencode::error::OK, bencode::Reader::Parse(is, writer));
+  EXPECT_EQ(bencode, os.get());
+}
+
+TEST(istream_wrapper, span_across_refill) {
+  const auto payload = LongString(100000);
+  std::stringstream ss;
+  ss << "0:" << payload.size() << ":" << payload << "1:x";
+
+  UnbufferedStreamBuf sb(ss.str());
+  std::istream in(&sb);
+  bencode::IStreamWrapper is(in);
+
+  EXPECT_EQ("0:", is.next(2));
+  is.skip(std::to_string(payload.size()).size() + 1);
+  EXPECT_EQ(payload, is.next(payload.size()));
+  EXPECT_EQ("1:x", is.next(3));
+  EXPECT_FALSE(is.hasNext());
+  EXPECT_EQ('\0', is.peek());
+  EXPECT_EQ("", is.next(8));
+}
+
+TEST(istream_wrapper, tell) {
+  const auto payload = LongString(100000);
+  const auto root = "l" + std::to_string(payload.size()) + ":" + payload +
+                    "i-42ee";
+  const auto bencode = root + "i1e";
+
+  {
+    std::stringstream ss(bencode);
+    bencode::IStreamWrapper is(ss);
+    bencode::Document doc;
+    ASSERT_EQ(bencode::error::OK,
+              doc.ParseStream<bencode::kParseStopWhenDoneFlag>(is));
+    EXPECT_EQ(root.size(), is.tell());
+  }
+  {
+    UnbufferedStreamBuf sb(bencode);
+    std::istream in(&sb);
+    char buffer[16];
+    bencode::IStreamWrapper is(in, buffer);
+    bencode::Document doc;
+    ASSERT_EQ(bencode::error::OK,
+              doc.ParseStream<bencode::kParseStopWhenDoneFlag>(is));
+    EXPECT_EQ(root.size(), is.tell());
+    EXPECT_EQ('i', is.next());
+    EXPECT_EQ(root.size() + 1, is.tell());
+  }
+}
+
+TEST(file_read_stream, span_across_refill) {
+  const auto payload = LongString(1000);
+  const std::string bencode = "l" + std::to_string(payload.size()) + ":" +
+                              payload + "3:abce";
+
+  const TempFile file(bencode);
+  ASSERT_NE(nullptr, file.get());
+
+  for (const std::size_t size : {4, 7, 256, 4096}) {
+    std::rewind(file.get());
+    std::string buffer(size, '\0');
+    bencode::FileReadStream rs(file.get(), buffer.data(), buffer.size());
+    bencode::Document doc;
+    ASSERT_EQ(bencode::error::OK, doc.ParseStream(rs)) << size;
+    ASSERT_EQ(2u, doc.GetSize());
+    EXPECT_EQ(payload, doc[0].GetString()) << size;
+    EXPECT_EQ("abc", doc[1].GetString()) << size;
+  }
+}
+
+TEST(file_read_stream, tell) {
+  const auto payload = LongString(1000);
+  const auto root = "d4:data" + std::to_string(payload.size()) + ":" +
+                    payload + "e";
+  const TempFile file(root + "i1e");
+  ASSERT_NE(nullptr, file.get());
+
+  for (const std::size_t size : {4, 7, 256, 4096}) {
+    std::rewind(file.get());
+    std::string buffer(size, '\0');
+    bencode::FileReadStream rs(file.get(), buffer.data(), buffer.size());
+    EXPECT_EQ(0UL, rs.tell());
+    bencode::Document doc;
+    ASSERT_EQ(bencode::error::OK,
+              doc.ParseStream<bencode::kParseStopWhenDoneFlag>(rs))
+        << size;
+    EXPECT_EQ(root.size(), rs.tell()) << size;
+    rs.skip(3);
+    EXPECT_EQ(root.size() + 3, rs.tell()) << size;
+  }
+}
+
+TEST(ostream_wrapper, block_writes) {
+  bencode::Value list(bencode::B_LIST);
+  for (int64_t i = 0; i < 10000; ++i) {
+    list.AddValue(bencode::Value(i * 7919 - 5000));
+  }
+  list.AddValue(bencode::Value(LongString(5000)));
+
+  bencode::StringWriteStream expect;
+  bencode::Writer expect_writer(expect);
+  list.WriteTo(expect_writer);
+
+  CountingStreamBuf sb;
+  std::ostream out(&sb);
+  {
+    char buffer[4096];
+    bencode::OStreamWrapper os(out, buffer);
+    bencode::Writer writer(os);
+    list.WriteTo(writer);
+  }
+
+  EXPECT_EQ(expect.get(), sb.data());
+  EXPECT_GT(expect.get().size() / 4096 + 4, sb.calls());
+}
+
+TEST(fd_write_stream, write) {
+  for (const bool direct : {false, true}) {
+    const TempFile file;
+    ASSERT_NE(nullptr, file.get());
+
+    const auto records = [](auto &writer) {
+      for (int64_t i = 0; i < 1000; ++i) {
+        writer.StartDict();
+        writer.Key("id");
+        writer.Integer(i);
+        writer.Key("payload");
+        writer.String(LongString(static_cast<std::size_t>(i % 50) * 400));
+        writer.EndDict();
+      }
+    };
+
+    bencode::StringWriteStream expect;
+    bencode::Writer expect_writer(expect);
+    records(expect_writer);
+    {
+      bencode::FdWriteStream os(file.fd(), 8192, direct);
+      bencode::Writer writer(os);
+      records(writer);
+      os.finish();
+      EXPECT_EQ(0, os.error());
+    }
+
+    EXPECT_EQ(expect.get(), file.ReadAll());
+  }
+}
+
+TEST(fd_write_stream, flush) {
+  for (const bool direct : {false, true}) {
+    const TempFile file;
+    ASSERT_NE(nullptr, file.get());
+
+    std::string expect;
+    bencode::FdWriteStream os(file.fd(), 8192, direct);
+    bencode::Writer writer(os);
+    // a top-level value is on the descriptor once the writer ends it
+    for (int64_t i = 0; i < 100; ++i) {
+      writer.Integer(i);
+      expect += "i" + std::to_string(i) + "e";
+      ASSERT_EQ(expect, file.ReadAll()) << direct;
+    }
+    const auto payload = LongString(20000);
+    writer.String(payload);
+    expect += std::to_string(payload.size()) + ":" + payload;
+    EXPECT_EQ(expect, file.ReadAll()) << direct;
+    EXPECT_FALSE(os.direct());
+    EXPECT_EQ(0, os.error());
+  }
+}
+
+TEST(fd_write_stream, allocation_failure) {
+  EXPECT_THROW(
+      bencode::FdWriteStream(0, std::numeric_limits<std::size_t>::max()),
+      std::bad_alloc);
+}
+
+TEST(fd_write_stream, direct_unaligned_offset) {
+  const TempFile file;
+  ASSERT_NE(nullptr, file.get());
+  ASSERT_EQ(3, ::write(file.fd(), "abc", 3));
+
+  const auto payload = LongString(20000);
+  {
+    bencode::FdWriteStream os(file.fd(), 8192, true);
+    EXPECT_FALSE(os.direct());
+    os.put_sv(payload);
+    os.finish();
+    EXPECT_EQ(0, os.error());
+  }
+  EXPECT_EQ("abc" + payload, file.ReadAll());
+}
+
+#if defined(__GNUC__)
+BENCODE_DIAG_POP
+#endif
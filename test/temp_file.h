@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCODE_TEST_TEMP_FILE_H
+#define BENCODE_TEST_TEMP_FILE_H
+
+#include <cstdio>
+
+#include <string>
+#include <string_view>
+
+#include "bencode/non_copyable.h"
+
+/**
+ * @brief anonymous temporary file for the stream tests, filled with content
+ * and rewound, closed when it goes out of scope
+ */
+class TempFile : bencode::NonCopyable {
+  std::FILE *fp_;
+
+public:
+  explicit TempFile(const std::string_view content = {})
+      : fp_(std::tmpfile()) {
+    if (fp_ != nullptr && !content.empty()) {
+      std::fwrite(content.data(), 1, content.size(), fp_);
+      std::rewind(fp_);
+    }
+  }
+  ~TempFile() {
+    if (fp_ != nullptr) {
+      std::fclose(fp_);
+    }
+  }
+
+  [[nodiscard]] std::FILE *get() const { return fp_; }
+  [[nodiscard]] int fd() const { return fileno(fp_); }
+
+  /**
+   * @brief the whole file from the start, leaves the position at the end
+   */
+  [[nodiscard]] std::string ReadAll() const {
+    std::string str;
+    std::rewind(fp_);
+    char buffer[4096];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), fp_)) > 0;) {
+      str.append(buffer, n);
+    }
+    return str;
+  }
+};
+
+#endif // BENCODE_TEST_TEMP_FILE_H
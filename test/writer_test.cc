@@ -0,0 +1,195 @@
+// MIT License
+//
+// Copyright (c) 2023 HominSu
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cctype>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+
+#include "bencode/document.h"
+#include "bencode/reader.h"
+#include "bencode/string_read_stream.h"
+#include "bencode/string_write_stream.h"
+#include "bencode/value.h"
+#include "bencode/writer.h"
+
+#include "gtest/gtest.h"
+
+#if defined(__GNUC__)
+BENCODE_DIAG_PUSH
+BENCODE_DIAG_OFF(effc++)
+#endif
+
+template <typename T> static std::string Encode(const T &value) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  value.WriteTo(writer);
+  return std::string(os.get());
+}
+
+TEST(writer, raw_value) {
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  writer.StartDict();
+  writer.Key("announce");
+  writer.String("udp://tracker");
+  writer.Key("info");
+  writer.RawValue("d6:lengthi42e4:name3:abce");
+  writer.EndDict();
+  EXPECT_EQ("d8:announce13:udp://tracker4:infod6:lengthi42e4:name3:abcee",
+            os.get());
+}
+
+TEST(writer, raw_dom_value) {
+  constexpr std::string_view kInfo = "d6:lengthi42e4:name3:abc6:pieces0:e";
+
+  bencode::Value torrent(bencode::B_DICT);
+  torrent.AddMember("announce", "udp://tracker");
+  bencode::Value info;
+  info.SetRaw(kInfo);
+  torrent.AddMember(bencode::Value("info"), std::move(info));
+  EXPECT_TRUE(torrent["info"].IsRaw());
+  EXPECT_EQ(kInfo, torrent["info"].GetRaw());
+
+  const auto expect =
+      "d8:announce13:udp://tracker4:info" + std::string(kInfo) + "e";
+  EXPECT_EQ(expect, Encode(torrent));
+
+  // handlers without RawValue get the raw value replayed as events
+  bencode::Document doc;
+  ASSERT_TRUE(torrent.WriteTo(doc));
+  EXPECT_FALSE(doc["info"].IsRaw());
+  EXPECT_EQ(42, doc["info"]["length"].GetInteger());
+  EXPECT_EQ(expect, Encode(doc));
+}
+
+TEST(writer, integers) {
+  const int64_t values[] = {0, -1, 42, INT64_MAX, INT64_MIN};
+  constexpr std::string_view kExpect =
+      "li0ei-1ei42ei9223372036854775807ei-9223372036854775808ee";
+
+  bencode::StringWriteStream os;
+  bencode::Writer writer(os);
+  writer.StartList();
+  writer.Integers(values);
+  writer.EndList();
+  EXPECT_EQ(kExpect, os.get());
+
+  bencode::StringWriteStream batch_os;
+  bencode::BatchWriter batch_writer(batch_os);
+  batch_writer.StartList();
+  batch_writer.Integers(values);
+  batch_writer.EndList();
+  EXPECT_EQ(kExpect, batch_os.get());
+}
+
+TEST(writer, integer_list) {
+  bencode::Value list(bencode::B_LIST);
+  std::string expect = "l";
+  for (int64_t i = 0; i < 300; ++i) {
+    if (i % 97 == 0) {
+      list.AddValue(bencode::Value("s"));
+      expect += "1:s";
+    }
+    list.AddValue(bencode::Value(i * i - 1000));
+    expect += "i" + std::to_string(i * i - 1000) + "e";
+  }
+  expect += "e";
+  EXPECT_EQ(expect, Encode(list));
+
+  bencode::StringWriteStream os;
+  bencode::BatchWriter writer(os);
+  ASSERT_TRUE(list.WriteTo(writer));
+  EXPECT_EQ(expect, os.get());
+}
+
+class CountingWriter : public bencode::Writer<bencode::StringWriteStream> {
+  std::size_t integers_ = 0;
+
+public:
+  using Writer::Writer;
+
+  [[nodiscard]] std::size_t integers() const { return integers_; }
+
+  bool Integer(const int64_t i64) override {
+    ++integers_;
+    return Writer::Integer(i64);
+  }
+};
+
+TEST(writer, integer_override) {
+  // a writer that only overrides Integer() still sees every list element
+  bencode::Document doc;
+  ASSERT_EQ(bencode::error::OK, doc.Parse("li1ei2e1:ali3eei4ee"));
+  bencode::StringWriteStream os;
+  CountingWriter writer(os);
+  ASSERT_TRUE(doc.WriteTo(writer));
+  EXPECT_EQ(4UL, writer.integers());
+  EXPECT_EQ("li1ei2e1:ali3eei4ee", os.get());
+
+  bencode::Document packed;
+  ASSERT_EQ(bencode::error::OK,
+            packed.Parse<bencode::kParsePackListsFlag>("li1ei2ei3ee"));
+  ASSERT_TRUE(packed.IsPacked());
+  bencode::StringWriteStream packed_os;
+  CountingWriter packed_writer(packed_os);
+  ASSERT_TRUE(packed.WriteTo(packed_writer));
+  EXPECT_EQ(3UL, packed_writer.integers());
+}
+
+class UpperWriter : public bencode::Writer<bencode::StringWriteStream> {
+public:
+  using Writer::Writer;
+
+  bool String(const std::string_view str) override {
+    std::string upper(str);
+    for (auto &ch : upper) {
+      ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    }
+    return Writer::String(upper);
+  }
+};
+
+TEST(writer, string_override) {
+  // a plain writer gets every parsed string through String()
+  const auto bencode = "d1:sl5:hello100000:" + std::string(100000, 'x') + "ee";
+
+  bencode::StringReadStream rs(bencode);
+  bencode::StringWriteStream os;
+  UpperWriter writer(os);
+  ASSERT_EQ(bencode::error::OK, bencode::Reader::Parse(rs, writer));
+  EXPECT_EQ("d1:sl5:HELLO100000:" + std::string(100000, 'X') + "ee",
+            os.get());
+
+  // a chunked writer copies them through untouched
+  bencode::StringReadStream chunked_rs(bencode);
+  bencode::StringWriteStream chunked_os;
+  bencode::ChunkedWriter chunked_writer(chunked_os);
+  ASSERT_EQ(bencode::error::OK,
+            bencode::Reader::Parse(chunked_rs, chunked_writer));
+  EXPECT_EQ(bencode, chunked_os.get());
+}
+
+#if defined(__GNUC__)
+BENCODE_DIAG_POP
+#endif